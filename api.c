@@ -0,0 +1,173 @@
+#include <stddef.h>
+#include "grid.c"
+
+/**
+ * Embeddable API, built as a shared library (make lib) to drive simulations without spawning the program
+ * <p>
+ * A typical use from Python with ctypes and numpy:
+ * <pre>
+ * grid = lib.simulation_create(1, 256, 0., 0., 42)
+ * lib.simulation_ignite(grid, 42, 128)
+ * lib.simulation_step(grid, 100)
+ * view = lib.simulation_view(grid)
+ * types = numpy.lib.stride_tricks.as_strided(numpy.ctypeslib.as_array(view.current_type, ...),
+ *                                            (view.width, view.height), view.strides)
+ * </pre>
+ * </p>
+ */
+
+/**
+ * Represents a zero-copy view of the current type and state planes of a grid
+ * <p>
+ * The planes are not copied, they point into the tiles of the grid. The view is valid until the next call to
+ * simulation_step or simulation_destroy, as a tick swaps the buffers of the grid.
+ * </p>
+ */
+typedef struct {
+	/**
+	 * The current type of the first tile of the grid (int values of TileType)
+	 */
+	int * current_type;
+	/**
+	 * The state of the first tile of the grid
+	 */
+	int * state;
+	/**
+	 * The size of the planes on the x axis
+	 */
+	int width;
+	/**
+	 * The size of the planes on the y axis
+	 */
+	int height;
+	/**
+	 * The size in bytes of an element of the planes
+	 */
+	size_t item_size;
+	/**
+	 * The strides in bytes of the planes, on the x axis and on the y axis
+	 */
+	ptrdiff_t strides[2];
+} PlaneView;
+
+/**
+ * Create a simulation, without graphics nor exports
+ * <p>
+ * The terrain is generated from the seed, or loaded from grid.json if it exists in the working directory. No tile is
+ * set on fire, the fires are started with simulation_ignite.
+ * </p>
+ *
+ * @param model The model of the grid (0-3)
+ * @param size The size of the grid
+ * @param wind_direction The wind direction (0 to 360)
+ * @param wind_speed The wind speed
+ * @param seed The seed of the random number generator
+ * @return The created grid, to destroy with simulation_destroy
+ */
+Grid * simulation_create(int model, int size, double wind_direction, double wind_speed, uint64_t seed) {
+	Random random;
+	seed_random(&random, seed);
+	Tile ** terrain = create_terrain(size, &random, false);
+
+	Grid * grid = malloc(sizeof(*grid));
+	*grid = create_grid_from_tiles(model, terrain, size, seed, (Window) {.window = NULL, .surface = NULL}, 0, 0, false,
+								   false);
+	free_tiles(terrain);
+	grid->wind_direction = wind_direction;
+	grid->wind_speed = wind_speed;
+	grid->ended = is_ended(*grid);
+
+	return grid;
+}
+
+/**
+ * Set a tile on fire
+ *
+ * @param grid The grid
+ * @param x The x coordinate of the tile
+ * @param y The y coordinate of the tile
+ * @return True if the tile was set on fire, false if it is outside the grid
+ */
+bool simulation_ignite(Grid * grid, int x, int y) {
+	return ignite(grid, (Point) {x, y});
+}
+
+/**
+ * Run ticks on a simulation, stopping early if the simulation ends
+ *
+ * @param grid The grid
+ * @param ticks The max number of ticks to run
+ * @return The number of ticks that were run
+ */
+int simulation_step(Grid * grid, int ticks) {
+	return ticks > 0 ? run_grid(grid, ticks) : 0;
+}
+
+/**
+ * Check if a simulation has ended
+ *
+ * @param grid The grid
+ * @return True if there is no more fire, false otherwise
+ */
+bool simulation_ended(Grid * grid) {
+	return grid->ended;
+}
+
+/**
+ * Get a zero-copy view of the current type and state planes of a simulation
+ *
+ * @param grid The grid
+ * @return The view of the planes
+ */
+PlaneView simulation_view(Grid * grid) {
+	Tile * first = grid->data[0];
+
+	return (PlaneView) {
+			.current_type = (int *) &first->current_type,
+			.state = &first->state,
+			.width = grid->size,
+			.height = grid->size,
+			.item_size = sizeof(int),
+			.strides = {(ptrdiff_t) (grid->size * sizeof(Tile)), (ptrdiff_t) sizeof(Tile)}
+	};
+}
+
+/**
+ * Fork a simulation : the fork continues from the current state with its own random number generator, sharing the
+ * tiles until it first modifies them
+ * <p>
+ * The simulation must not be stepped, ignited nor destroyed while it has forks.
+ * </p>
+ *
+ * @param grid The grid to fork
+ * @param seed The seed of the random number generator of the fork
+ * @return The fork, to destroy with simulation_destroy
+ */
+Grid * simulation_fork(Grid * grid, uint64_t seed) {
+	Grid * child = malloc(sizeof(*child));
+
+	*child = fork_grid(grid, seed);
+
+	return child;
+}
+
+/**
+ * Set the wind of a simulation, for example to branch a fork on another wind
+ *
+ * @param grid The grid
+ * @param wind_direction The wind direction (0 to 360)
+ * @param wind_speed The wind speed
+ */
+void simulation_set_wind(Grid * grid, double wind_direction, double wind_speed) {
+	set_wind(grid, wind_direction, wind_speed);
+}
+
+/**
+ * Destroy a simulation
+ *
+ * @param grid The grid to destroy
+ */
+void simulation_destroy(Grid * grid) {
+	destroy_grid(*grid);
+	free(grid);
+}
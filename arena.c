@@ -0,0 +1,224 @@
+#pragma once
+#include <pthread.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#include "live.c"
+
+/**
+ * The alignment of the allocations of the arenas (a cache line)
+ */
+const size_t ARENA_ALIGNMENT = 64;
+/**
+ * The size of a huge page
+ */
+const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+/**
+ * The max number of released arenas kept by a thread for reuse
+ */
+#define ARENA_CACHE_SIZE 2
+
+/**
+ * Whether the arenas are backed by huge pages when they are large enough
+ */
+bool use_huge_pages = false;
+
+/**
+ * Represents the arenas released by a thread, kept mapped so the next grids of the thread reuse their pages
+ */
+typedef struct {
+	/**
+	 * The released arenas
+	 */
+	Arena * arenas[ARENA_CACHE_SIZE];
+	/**
+	 * The number of released arenas
+	 */
+	int count;
+} ArenaCache;
+
+/**
+ * The arenas released by the current thread
+ */
+__thread ArenaCache arena_cache = {.count = 0};
+
+/**
+ * The key destroying the arenas released by a thread when it exits
+ */
+pthread_key_t arena_cache_key;
+/**
+ * Whether arena_cache_key was created
+ */
+pthread_once_t arena_cache_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Round a size up to a multiple of an alignment
+ *
+ * @param size The size
+ * @param alignment The alignment (a power of 2)
+ * @return The rounded size
+ */
+size_t align_size(size_t size, size_t alignment) {
+	return (size + alignment - 1) & ~(alignment - 1);
+}
+
+/**
+ * Create an arena, its memory is mapped directly so it is returned to the system when the arena is destroyed
+ * <p>
+ * If use_huge_pages is set, large arenas are backed by huge pages (reserved ones if available, otherwise transparent
+ * ones).
+ * </p>
+ *
+ * @param capacity The size of the allocatable memory
+ * @return The created arena (zeroed), to destroy with destroy_arena, or NULL if the memory could not be mapped
+ */
+Arena * create_arena(size_t capacity) {
+	size_t header = align_size(sizeof(Arena), ARENA_ALIGNMENT);
+	size_t size = header + align_size(capacity, ARENA_ALIGNMENT);
+	void * memory = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+	if (use_huge_pages && size >= HUGE_PAGE_SIZE) {
+		memory = mmap(NULL, align_size(size, HUGE_PAGE_SIZE), PROT_READ | PROT_WRITE,
+					  MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (memory != MAP_FAILED) {
+			size = align_size(size, HUGE_PAGE_SIZE);
+		}
+	}
+#endif
+
+	if (memory == MAP_FAILED) {
+		memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (memory == MAP_FAILED) {
+			fprintf(stderr, "Failed to map an arena of %zu bytes\n", size);
+			return NULL;
+		}
+
+#ifdef MADV_HUGEPAGE
+		if (use_huge_pages && size >= HUGE_PAGE_SIZE) {
+			madvise(memory, size, MADV_HUGEPAGE);
+		}
+#endif
+	}
+
+	add_live_counter(LIVE_MEMORY, size);
+
+	Arena * arena = memory;
+	*arena = (Arena) {
+			.base = (char *) memory + header,
+			.capacity = size - header,
+			.used = 0,
+			.mapped = size
+	};
+
+	return arena;
+}
+
+/**
+ * Allocate memory in an arena
+ *
+ * @param arena The arena
+ * @param size The size of the memory
+ * @return The allocated memory (aligned on ARENA_ALIGNMENT), or NULL if the arena is full
+ */
+void * allocate_in_arena(Arena * arena, size_t size) {
+	size = align_size(size, ARENA_ALIGNMENT);
+	if (arena->used + size > arena->capacity) {
+		fprintf(stderr, "Arena full (%zu of %zu bytes used, %zu requested)\n", arena->used, arena->capacity, size);
+		return NULL;
+	}
+
+	void * memory = arena->base + arena->used;
+	arena->used += size;
+
+	return memory;
+}
+
+/**
+ * Release all the allocations of an arena at once, the memory can then be allocated again
+ *
+ * @param arena The arena
+ */
+void reset_arena(Arena * arena) {
+	arena->used = 0;
+}
+
+/**
+ * Destroy an arena and all its allocations at once
+ *
+ * @param arena The arena to destroy (can be NULL)
+ */
+void destroy_arena(Arena * arena) {
+	if (arena) {
+		add_live_counter(LIVE_MEMORY, -(int64_t) arena->mapped);
+		munmap(arena, arena->mapped);
+	}
+}
+
+/**
+ * Destroy the arenas released by a thread (called when the thread exits)
+ *
+ * @param argument The cache of the thread
+ */
+void destroy_arena_cache(void * argument) {
+	ArenaCache * cache = argument;
+
+	for (int i = 0; i < cache->count; i++) {
+		destroy_arena(cache->arenas[i]);
+	}
+	cache->count = 0;
+}
+
+/**
+ * Create the key destroying the arenas released by a thread when it exits
+ */
+void create_arena_cache_key() {
+	pthread_key_create(&arena_cache_key, destroy_arena_cache);
+}
+
+/**
+ * Get an arena, reusing one released by the current thread if one is large enough
+ * <p>
+ * The pages of a reused arena are already mapped, so a grid created after another one ended does not fault them in
+ * again. The memory of a reused arena is not zeroed.
+ * </p>
+ *
+ * @param capacity The size of the allocatable memory
+ * @return The arena, to give back with release_arena
+ */
+Arena * acquire_arena(size_t capacity) {
+	for (int i = arena_cache.count - 1; i >= 0; i--) {
+		Arena * arena = arena_cache.arenas[i];
+
+		// A much larger arena is left for the grids it was made for
+		if (arena->capacity >= capacity && arena->capacity <= 2 * align_size(capacity, HUGE_PAGE_SIZE)) {
+			arena_cache.arenas[i] = arena_cache.arenas[--arena_cache.count];
+			reset_arena(arena);
+			return arena;
+		}
+	}
+
+	return create_arena(capacity);
+}
+
+/**
+ * Give back an arena got with acquire_arena, it is kept by the current thread for reuse or destroyed if the thread
+ * already keeps ARENA_CACHE_SIZE arenas
+ *
+ * @param arena The arena (can be NULL)
+ */
+void release_arena(Arena * arena) {
+	if (arena == NULL) {
+		return;
+	}
+
+	if (arena_cache.count == ARENA_CACHE_SIZE) {
+		destroy_arena(arena);
+		return;
+	}
+
+	// The cache of the thread is destroyed with the thread
+	pthread_once(&arena_cache_once, create_arena_cache_key);
+	pthread_setspecific(arena_cache_key, &arena_cache);
+	arena_cache.arenas[arena_cache.count++] = arena;
+}
@@ -0,0 +1,344 @@
+#pragma once
+#include <time.h>
+#include "grid.c"
+
+/**
+ * Represents a tile waiting in the queue of the arrival times
+ */
+typedef struct {
+	/**
+	 * The arrival time of the tile when it was queued
+	 */
+	double time;
+	/**
+	 * The index of the tile (x * size + y)
+	 */
+	int index;
+} ArrivalNode;
+
+/**
+ * Represents the queue of the arrival times : a binary min-heap on the time, a tile can be queued several times and
+ * only its earliest entry is used
+ */
+typedef struct {
+	/**
+	 * The queued tiles
+	 */
+	ArrivalNode * nodes;
+	/**
+	 * The number of queued tiles
+	 */
+	size_t count;
+	/**
+	 * The number of tiles the queue can hold before growing
+	 */
+	size_t capacity;
+} ArrivalQueue;
+
+/**
+ * Queue a tile
+ *
+ * @param queue The queue
+ * @param time The arrival time of the tile
+ * @param index The index of the tile
+ */
+void push_arrival(ArrivalQueue * queue, double time, int index) {
+	if (queue->count == queue->capacity) {
+		queue->capacity = max(2 * queue->capacity, 64);
+		queue->nodes = realloc(queue->nodes, queue->capacity * sizeof(*queue->nodes));
+	}
+
+	size_t i = queue->count++;
+	while (i > 0 && queue->nodes[(i - 1) / 2].time > time) {
+		queue->nodes[i] = queue->nodes[(i - 1) / 2];
+		i = (i - 1) / 2;
+	}
+	queue->nodes[i] = (ArrivalNode) {.time = time, .index = index};
+}
+
+/**
+ * Remove the earliest tile of a queue
+ *
+ * @param queue The queue (not empty)
+ * @return The earliest tile
+ */
+ArrivalNode pop_arrival(ArrivalQueue * queue) {
+	ArrivalNode first = queue->nodes[0];
+	ArrivalNode last = queue->nodes[--queue->count];
+
+	size_t i = 0;
+	while (2 * i + 1 < queue->count) {
+		size_t child = 2 * i + 1;
+		if (child + 1 < queue->count && queue->nodes[child + 1].time < queue->nodes[child].time) {
+			child++;
+		}
+		if (queue->nodes[child].time >= last.time) {
+			break;
+		}
+
+		queue->nodes[i] = queue->nodes[child];
+		i = child;
+	}
+	queue->nodes[i] = last;
+
+	return first;
+}
+
+/**
+ * Get the probability for a tile on fire to set a neighbor on fire during one tick, with the rules of the model of
+ * the grid
+ *
+ * @param grid The grid
+ * @param point The tile on fire
+ * @param neighbor The neighbor
+ * @return The probability (0 if the neighbor cannot burn)
+ */
+double get_spread_probability(Grid * grid, Point point, Point neighbor) {
+	Tile tile = get_tile(*grid, neighbor);
+	int direction = get_direction(point, neighbor);
+	const SpreadTable * spread = get_spread_at(grid, point);
+
+	if (grid->model == 0 || grid->model == 1) {
+		bool diagonal = neighbor.x != point.x && neighbor.y != point.y;
+		int tree_burn = grid->model == 0 ? M0_PROBA_TREE_BURN : diagonal ? M1_D_PROBA_TREE_BURN : M1_C_PROBA_TREE_BURN;
+		int grass_burn = grid->model == 0 ? M0_PROBA_GRASS_BURN :
+						 diagonal ? M1_D_PROBA_GRASS_BURN : M1_C_PROBA_GRASS_BURN;
+
+		return tile.current_type == TREE ? 1. / tree_burn : tile.current_type == GRASS ? 1. / grass_burn : 0;
+	} else if (grid->model == 2) {
+		return fmin(fmax(spread->burn[tile.current_type][direction], 0), 1);
+	} else {
+		if (tile.current_type != TREE && tile.current_type != GRASS) {
+			return 0;
+		}
+
+		double slope = get_slope(point, neighbor, grid);
+		return slope == 0 ? spread->flat_burn[direction] :
+			   get_rothermel_probability(slope, spread->wind_phi[direction]);
+	}
+}
+
+/**
+ * Compute the expected arrival time of the fire on every tile of a grid, without simulating it
+ * <p>
+ * The fire spreads from the tiles on fire along the neighbors of the model (4 for the models 0 and 3, 8 for the models
+ * 1 and 2). A tile that sets a neighbor on fire with the probability p per tick needs 1 / p ticks on average, so the
+ * arrival time of a tile is the shortest path to it with these costs, computed with Dijkstra's algorithm in
+ * O(N log N). The tiles that already burnt keep their ignition tick.
+ * </p>
+ *
+ * @param grid The grid, its wind and its current tick are used
+ * @return The arrival time of each tile at index x * size + y (INFINITY if the fire cannot reach it), to free
+ */
+double * compute_arrival_times(Grid * grid) {
+	if (!grid->spread.ready) {
+		grid->spread = create_spread_table(grid->wind_direction, grid->wind_speed);
+	}
+
+	int size = grid->size;
+	size_t n_tiles = (size_t) size * size;
+	double * arrival = malloc(n_tiles * sizeof(*arrival));
+	ArrivalQueue queue = {.nodes = NULL, .count = 0, .capacity = 0};
+
+	for (int x = 0; x < size; x++) {
+		for (int y = 0; y < size; y++) {
+			Tile tile = grid->data[x][y];
+			int index = x * size + y;
+
+			arrival[index] = INFINITY;
+			if (tile.current_type == BURNT || tile.current_type == FIRE) {
+				arrival[index] = tile.ignition_tick >= 0 ? tile.ignition_tick : grid->n_ticks;
+			}
+
+			// The tiles on fire spread from the current tick
+			if (tile.current_type == FIRE) {
+				push_arrival(&queue, grid->n_ticks, index);
+			}
+		}
+	}
+
+	int n_neighbors = grid->model == 1 || grid->model == 2 ? 8 : 4;
+	while (queue.count > 0) {
+		ArrivalNode node = pop_arrival(&queue);
+		Point point = {node.index / size, node.index % size};
+
+		// A tile reached earlier by another path was already spread from, the tiles on fire are queued at the current
+		// tick which can be after their ignition tick
+		if (node.time > arrival[node.index] && grid->data[point.x][point.y].current_type != FIRE) {
+			continue;
+		}
+
+		Point neighbors[8];
+		get_direct_neighbors(grid, point, neighbors);
+		get_diagonal_neighbors(grid, point, neighbors + 4);
+
+		for (int k = 0; k < n_neighbors; k++) {
+			if (!is_valid(grid, neighbors[k])) {
+				continue;
+			}
+
+			double probability = get_spread_probability(grid, point, neighbors[k]);
+			int index = neighbors[k].x * size + neighbors[k].y;
+			if (probability <= 0 || node.time + 1 / probability >= arrival[index]) {
+				continue;
+			}
+
+			arrival[index] = node.time + 1 / probability;
+			push_arrival(&queue, arrival[index], index);
+		}
+	}
+
+	free(queue.nodes);
+
+	return arrival;
+}
+
+/**
+ * Write arrival times to a csv file : for each tile its type and its arrival time (-1 if the fire cannot reach it)
+ *
+ * @param grid The grid
+ * @param arrival The arrival times of the tiles
+ * @param file_name The name of the file
+ */
+void write_arrival_csv(Grid grid, const double * arrival, const char * file_name) {
+	FILE * fp = fopen(file_name, "w");
+	if (!fp) {
+		fprintf(stderr, "Failed to open file %s for writing\n", file_name);
+		return;
+	}
+
+	fprintf(fp, "x,y,type,arrival_tick\n");
+
+	for (int x = 0; x < grid.size; x++) {
+		for (int y = 0; y < grid.size; y++) {
+			double time = arrival[(size_t) x * grid.size + y];
+			fprintf(fp, "%d,%d,%d,%.2f\n", x, y, grid.data[x][y].current_type, isinf(time) ? -1. : time);
+		}
+	}
+
+	fclose(fp);
+}
+
+/**
+ * Write arrival times to a png file (grayscale, white for the first tiles on fire, black for the last ones and the
+ * tiles the fire cannot reach)
+ *
+ * @param size The size of the grid
+ * @param arrival The arrival times of the tiles
+ * @param file_name The name of the file
+ */
+void write_arrival_png(int size, const double * arrival, const char * file_name) {
+	FILE * fp = fopen(file_name, "wb");
+	if (!fp) {
+		fprintf(stderr, "Failed to open file %s for writing\n", file_name);
+		return;
+	}
+
+	png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	png_infop info = png ? png_create_info_struct(png) : NULL;
+	if (!info) {
+		fprintf(stderr, "Failed to create png structs\n");
+		png_destroy_write_struct(&png, NULL);
+		fclose(fp);
+		return;
+	}
+
+	if (setjmp(png_jmpbuf(png))) { // To handle errors
+		printf("Error during png creation\n");
+		png_destroy_write_struct(&png, &info);
+		fclose(fp);
+		return;
+	}
+
+	png_init_io(png, fp);
+
+	double first = INFINITY;
+	double last = -INFINITY;
+	for (size_t i = 0; i < (size_t) size * size; i++) {
+		if (!isinf(arrival[i])) {
+			first = fmin(first, arrival[i]);
+			last = fmax(last, arrival[i]);
+		}
+	}
+
+	// Same layout as write_png : each tile is 2x2 pixels, x is the column
+	int width = 2 * size;
+	png_set_IHDR(png, info, width, width, 8, PNG_COLOR_TYPE_GRAY,
+				 PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+	png_write_info(png, info);
+
+	// Same banding as write_png, the arrival times are read in storage order
+	png_bytep rows = (png_bytep) malloc(2 * BAND_SIZE * width * sizeof(png_byte));
+	png_bytep band_rows[2 * BAND_SIZE];
+	for (int k = 0; k < 2 * BAND_SIZE; k++) {
+		band_rows[k] = rows + (size_t) k * width;
+	}
+
+	for (int band = 0; band < size; band += BAND_SIZE) {
+		int band_size = min(BAND_SIZE, size - band);
+
+		for (int x = 0; x < size; x++) {
+			for (int y = 0; y < band_size; y++) {
+				double time = arrival[(size_t) x * size + band + y];
+				png_byte pixel = isinf(time) ? 0 :
+								 (png_byte) (255. * (last > first ? (last - time) / (last - first) : 1) + .5);
+
+				band_rows[2 * y][2 * x] = band_rows[2 * y][2 * x + 1] = pixel;
+				band_rows[2 * y + 1][2 * x] = band_rows[2 * y + 1][2 * x + 1] = pixel;
+			}
+		}
+
+		png_write_rows(png, band_rows, 2 * band_size);
+	}
+
+	png_write_end(png, NULL);
+
+	fclose(fp);
+	png_destroy_write_struct(&png, &info);
+	free(rows);
+}
+
+/**
+ * Compute the expected arrival time of the fire on every tile of a terrain, and write them in arrival.csv and
+ * arrival.png
+ *
+ * @param model The model whose spread probabilities are used
+ * @param wind_direction The wind direction
+ * @param wind_speed The wind speed
+ * @param ignition The point set on fire, in addition to the default fire
+ * @param seed The seed of the terrain
+ * @return The exit code
+ */
+int run_arrival(int model, double wind_direction, double wind_speed, Point ignition, uint64_t seed) {
+	Grid grid = create_grid(model, GRID_SIZE, seed, (Window) {.window = NULL, .surface = NULL}, 0, 0, false, false);
+	ignite(&grid, (Point) {max(0, min(GRID_SIZE - 1, ignition.x)), max(0, min(GRID_SIZE - 1, ignition.y))});
+	set_wind(&grid, wind_direction, wind_speed);
+
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	double * arrival = compute_arrival_times(&grid);
+
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	double seconds = (double) (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+	int reached = 0;
+	double last = 0;
+	for (size_t i = 0; i < (size_t) GRID_SIZE * GRID_SIZE; i++) {
+		if (!isinf(arrival[i])) {
+			reached++;
+			last = fmax(last, arrival[i]);
+		}
+	}
+	printf("Computed the arrival times of %d tiles in %.2f ms: %d reached, the last one at tick %.1f\n",
+		   GRID_SIZE * GRID_SIZE, seconds * 1e3, reached, last);
+
+	write_arrival_csv(grid, arrival, "arrival.csv");
+	write_arrival_png(GRID_SIZE, arrival, "arrival.png");
+
+	free(arrival);
+	destroy_grid(grid);
+
+	return 0;
+}
@@ -0,0 +1,294 @@
+#include <time.h>
+#include <sys/resource.h>
+#include "sweep.c"
+
+/**
+ * Benchmarks of the simulation kernels, built and run by make bench
+ * <p>
+ * Every scenario is seeded, so two versions of the program run exactly the same ticks and their timings can be
+ * compared. The results are written as json on stdout.
+ * </p>
+ */
+
+/**
+ * The seed of the benchmarks
+ */
+const uint64_t BENCH_SEED = 42;
+
+/**
+ * Receives the results of the calls timed alone, so the compiler cannot drop them
+ */
+volatile int bench_sink = 0;
+
+/**
+ * Represents a scenario of the benchmarks
+ */
+typedef struct {
+	/**
+	 * The model of the grid
+	 */
+	int model;
+	/**
+	 * The size of the grid
+	 */
+	int size;
+	/**
+	 * Whether the fire front is dense (a line of fire across the grid and scattered fires) or sparse (the default
+	 * fire only)
+	 */
+	bool dense;
+	/**
+	 * The wind direction
+	 */
+	double wind_direction;
+	/**
+	 * The wind speed
+	 */
+	double wind_speed;
+} BenchScenario;
+
+/**
+ * Get the current time
+ *
+ * @return The current time in nanoseconds, from an arbitrary origin
+ */
+double get_time_ns() {
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+
+	return (double) time.tv_sec * 1e9 + (double) time.tv_nsec;
+}
+
+/**
+ * Get the peak resident set size of the process, over all the benchmarks run so far (only reported once, at the end)
+ *
+ * @return The peak resident set size in kilobytes
+ */
+long get_peak_rss() {
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+
+	return usage.ru_maxrss;
+}
+
+/**
+ * Create the grid of a scenario
+ *
+ * @param scenario The scenario
+ * @return The created grid, to destroy with destroy_grid
+ */
+Grid create_bench_grid(BenchScenario scenario) {
+	Grid grid = create_grid(scenario.model, scenario.size, BENCH_SEED, (Window) {.window = NULL, .surface = NULL}, 0,
+							0, false, false);
+
+	if (scenario.dense) {
+		// The scattered fires use their own generator, so the generator of the grid is the same in both scenarios
+		Random random;
+		seed_random(&random, BENCH_SEED + 1);
+
+		for (int y = 0; y < scenario.size; y++) {
+			ignite(&grid, (Point) {scenario.size / 2, y});
+		}
+		for (int i = 0; i < scenario.size * scenario.size / 50; i++) {
+			ignite(&grid, (Point) {get_random(&random, scenario.size), get_random(&random, scenario.size)});
+		}
+	}
+
+	set_wind(&grid, scenario.wind_direction, scenario.wind_speed);
+
+	return grid;
+}
+
+/**
+ * Run a scenario and write its result, keeping the fastest of several repetitions
+ *
+ * @param fp The file the result is written to
+ * @param scenario The scenario
+ * @param max_ticks The max number of ticks of a repetition
+ * @param repeat The number of repetitions
+ */
+void run_bench_scenario(FILE * fp, BenchScenario scenario, int max_ticks, int repeat) {
+	double create_ns = INFINITY;
+	double tick_ns = INFINITY;
+	double is_ended_ns = INFINITY;
+	int ticks = 0;
+	long long burning = 0;
+
+	for (int r = 0; r < repeat; r++) {
+		double start = get_time_ns();
+		Grid grid = create_bench_grid(scenario);
+		create_ns = fmin(create_ns, get_time_ns() - start);
+
+		// The burning tiles are counted before each tick, they are the tiles the tick works on
+		ticks = 0;
+		burning = 0;
+		double tick_time = 0;
+		while (!grid.ended && ticks < max_ticks) {
+			burning += grid.statistics.burning;
+
+			start = get_time_ns();
+			tick(&grid);
+			grid.ended = is_ended(grid);
+			tick_time += get_time_ns() - start;
+
+			ticks++;
+		}
+		tick_ns = fmin(tick_ns, tick_time);
+
+		// is_ended is too fast to be timed alone
+		int calls = 100000;
+		start = get_time_ns();
+		for (int i = 0; i < calls; i++) {
+			bench_sink = is_ended(grid);
+		}
+		is_ended_ns = fmin(is_ended_ns, (get_time_ns() - start) / calls);
+
+		destroy_grid(grid);
+	}
+
+	double cells = (double) scenario.size * scenario.size * ticks;
+	fprintf(fp, "{\"kernel\":\"tick\",\"model\":%d,\"size\":%d,\"front\":\"%s\",\"wind_speed\":%g,"
+				"\"wind_direction\":%g,\"ticks\":%d,\"create_grid_ms\":%.3f,\"ticks_per_sec\":%.1f,\"cells_per_sec\":%.0f,"
+				"\"ns_per_burning_cell\":%.2f,\"is_ended_ns\":%.2f}",
+			scenario.model, scenario.size, scenario.dense ? "dense" : "sparse", scenario.wind_speed,
+			scenario.wind_direction, ticks, create_ns / 1e6, ticks ? ticks / (tick_ns / 1e9) : 0.,
+			ticks ? cells / (tick_ns / 1e9) : 0., burning ? tick_ns / burning : 0., is_ended_ns);
+}
+
+/**
+ * Run the benchmarks of the outputs (write_csv, write_png and draw_grid) for a grid size and write their results
+ *
+ * @param fp The file the results are written to
+ * @param size The size of the grid
+ * @param repeat The number of repetitions
+ * @param window The window to draw on (draw_grid is skipped without window)
+ */
+void run_bench_outputs(FILE * fp, int size, int repeat, Window window) {
+	BenchScenario scenario = {.model = 0, .size = size, .dense = true};
+	Grid grid = create_bench_grid(scenario);
+	grid.window = window;
+
+	double csv_ns = INFINITY;
+	double png_ns = INFINITY;
+	double draw_ns = INFINITY;
+	for (int r = 0; r < repeat; r++) {
+		remove("grids.csv");
+
+		double start = get_time_ns();
+		write_csv(grid);
+		csv_ns = fmin(csv_ns, get_time_ns() - start);
+
+		start = get_time_ns();
+		write_png(grid);
+		png_ns = fmin(png_ns, get_time_ns() - start);
+
+		if (window.window) {
+			start = get_time_ns();
+			draw_grid(window, grid);
+			draw_ns = fmin(draw_ns, get_time_ns() - start);
+		}
+	}
+
+	// The outputs of the benchmarks are not kept
+	char file_name[100];
+	sprintf(file_name, "grids_png/grid-%d-%d-%d.png", grid.coord_x, grid.coord_y, grid.n_intervals);
+	remove(file_name);
+	remove("grids.csv");
+
+	double cells = (double) size * size;
+	fprintf(fp, "{\"kernel\":\"write_csv\",\"size\":%d,\"ms\":%.3f,\"cells_per_sec\":%.0f},\n", size, csv_ns / 1e6,
+			cells / (csv_ns / 1e9));
+	fprintf(fp, "{\"kernel\":\"write_png\",\"size\":%d,\"ms\":%.3f,\"cells_per_sec\":%.0f}", size, png_ns / 1e6,
+			cells / (png_ns / 1e9));
+	if (window.window) {
+		fprintf(fp, ",\n{\"kernel\":\"draw_grid\",\"size\":%d,\"ms\":%.3f,\"cells_per_sec\":%.0f}", size,
+				draw_ns / 1e6, cells / (draw_ns / 1e9));
+	}
+
+	destroy_grid(grid);
+}
+
+/**
+ * Main function of the benchmarks
+ * <p>
+ * The benchmarks can be launched with the following arguments:
+ * <ul>
+ * <li>--sizes [list]: The grid sizes, as 64,256 or as start:stop:step (defaults to 64,256,512)</li>
+ * <li>--ticks [ticks]: The max number of ticks of a scenario (defaults to 200)</li>
+ * <li>--repeat [repeat]: The number of repetitions of a scenario, the fastest one is kept (defaults to 3)</li>
+ * </ul>
+ * </p>
+ * @param argc The number of arguments
+ * @param argv The arguments
+ * @return The exit code
+ */
+int main(int argc, char * argv[]) {
+	char * sizes = "64,256,512";
+	int max_ticks = 200;
+	int repeat = 3;
+
+	for (int i = 1; i + 1 < argc; i++) {
+		if (strcmp(argv[i], "--sizes") == 0) {
+			sizes = argv[i + 1];
+		} else if (strcmp(argv[i], "--ticks") == 0) {
+			max_ticks = atoi(argv[i + 1]);
+		} else if (strcmp(argv[i], "--repeat") == 0) {
+			repeat = max(atoi(argv[i + 1]), 1);
+		}
+	}
+
+	double * size_values;
+	int n_sizes = parse_values(sizes, &size_values);
+
+	// draw_grid is measured on a hidden window, with the dummy video driver when there is no display
+	setenv("SDL_VIDEODRIVER", "dummy", 0);
+	Window window = {.window = NULL, .surface = NULL};
+	if (SDL_Init(SDL_INIT_VIDEO) == 0) {
+		int width = 0;
+		for (int s = 0; s < n_sizes; s++) {
+			width = max(width, (int) size_values[s]);
+		}
+
+		window.window = SDL_CreateWindow("TIPE", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, width * TILE_SIZE,
+										 width * TILE_SIZE, SDL_WINDOW_HIDDEN);
+		window.surface = window.window ? SDL_GetWindowSurface(window.window) : NULL;
+		if (!window.surface) {
+			window.window = NULL;
+		}
+	}
+
+	double wind_speeds[2] = {0, 4};
+	printf("{\"seed\":%llu,\"ticks\":%d,\"repeat\":%d,\"results\":[\n", (unsigned long long) BENCH_SEED, max_ticks,
+		   repeat);
+	for (int s = 0; s < n_sizes; s++) {
+		int size = (int) size_values[s];
+
+		for (int model = 0; model < 4; model++) {
+			for (int dense = 0; dense < 2; dense++) {
+				for (int w = 0; w < 2; w++) {
+					BenchScenario scenario = {
+							.model = model,
+							.size = size,
+							.dense = dense,
+							.wind_direction = 60,
+							.wind_speed = wind_speeds[w]
+					};
+					run_bench_scenario(stdout, scenario, max_ticks, repeat);
+					printf(",\n");
+					fflush(stdout);
+				}
+			}
+		}
+
+		run_bench_outputs(stdout, size, repeat, window);
+		printf(s + 1 < n_sizes ? ",\n" : "\n");
+	}
+	printf("],\"peak_rss_kb\":%ld}\n", get_peak_rss());
+
+	if (window.window) {
+		destroy_window(window);
+	}
+	free(size_values);
+
+	return 0;
+}
@@ -0,0 +1,311 @@
+#pragma once
+#include "ensemble.c"
+
+/**
+ * The number of replicas simulated at once, one per bit of a word
+ */
+#define REPLICAS_PER_WORD 64
+
+/**
+ * Represents replicas of a grid of the model 0 or 1 simulated at once : the replicas share the terrain and differ only
+ * in their random numbers, the bit r of the words of a tile is its state in the replica r
+ */
+typedef struct {
+	/**
+	 * The model of the replicas (0 or 1)
+	 */
+	int model;
+	/**
+	 * The size of the grid
+	 */
+	int size;
+	/**
+	 * The replicas in use
+	 */
+	uint64_t mask;
+	/**
+	 * The number of ticks that were run
+	 */
+	int n_ticks;
+	/**
+	 * The random number generator of the replicas
+	 */
+	Random random;
+	/**
+	 * The type of each tile of the terrain (index x * size + y)
+	 */
+	TileType * types;
+	/**
+	 * The replicas in which each tile is on fire
+	 */
+	uint64_t * burning;
+	/**
+	 * The replicas in which each tile on fire changed state once (it burns out on the next change)
+	 */
+	uint64_t * changed;
+	/**
+	 * The replicas in which each tile has been on fire
+	 */
+	uint64_t * touched;
+	/**
+	 * The replicas in which each tile is set on fire during the current tick
+	 */
+	uint64_t * ignited;
+	/**
+	 * The sum of the ignition ticks of each tile over the replicas
+	 */
+	long long * ignition_ticks;
+	/**
+	 * The tiles on fire in at least one replica
+	 */
+	int * active;
+	/**
+	 * The number of tiles on fire in at least one replica
+	 */
+	int n_active;
+	/**
+	 * The tiles set on fire during the current tick
+	 */
+	int * next;
+	/**
+	 * The arena holding the arrays of the replicas
+	 */
+	Arena * arena;
+} BitslicedGrid;
+
+/**
+ * Check if a grid can be simulated with bit-sliced replicas
+ *
+ * @param model The model of the grid
+ * @return True for the models 0 and 1, whose probabilities are powers of 2
+ */
+bool is_bitsliceable(int model) {
+	return model == 0 || model == 1;
+}
+
+/**
+ * Get a word whose bits are set independently with the probability 1 / proba
+ *
+ * @param random The random number generator
+ * @param proba The inverse of the probability (a power of 2)
+ * @return The word
+ */
+uint64_t get_bernoulli_word(Random * random, int proba) {
+	// The bits of the and of k random words are set with the probability 1 / 2^k
+	uint64_t word = ~0ULL;
+	for (int p = proba; p > 1; p /= 2) {
+		word &= next_random(random);
+	}
+
+	return word;
+}
+
+/**
+ * Create bit-sliced replicas of a terrain
+ *
+ * @param model The model of the replicas (0 or 1)
+ * @param terrain The terrain, its tiles on fire are on fire in every replica
+ * @param size The size of the terrain
+ * @param n_replicas The number of replicas (1 to REPLICAS_PER_WORD)
+ * @param seed The seed of the random number generator
+ * @return The created replicas, to destroy with destroy_bitsliced_grid
+ */
+BitslicedGrid create_bitsliced_grid(int model, Tile ** terrain, int size, int n_replicas, uint64_t seed) {
+	size_t n_tiles = (size_t) size * size;
+	size_t words_size = align_size(n_tiles * sizeof(uint64_t), ARENA_ALIGNMENT);
+
+	// The arena is mapped zeroed, so the replicas start without fire
+	Arena * arena = create_arena(align_size(n_tiles * sizeof(TileType), ARENA_ALIGNMENT) + 4 * words_size +
+								 align_size(n_tiles * sizeof(long long), ARENA_ALIGNMENT) +
+								 2 * align_size(n_tiles * sizeof(int), ARENA_ALIGNMENT));
+
+	BitslicedGrid grid = {
+			.model = model,
+			.size = size,
+			.mask = n_replicas >= REPLICAS_PER_WORD ? ~0ULL : (1ULL << n_replicas) - 1,
+			.n_ticks = 0,
+			.types = allocate_in_arena(arena, n_tiles * sizeof(TileType)),
+			.burning = allocate_in_arena(arena, n_tiles * sizeof(uint64_t)),
+			.changed = allocate_in_arena(arena, n_tiles * sizeof(uint64_t)),
+			.touched = allocate_in_arena(arena, n_tiles * sizeof(uint64_t)),
+			.ignited = allocate_in_arena(arena, n_tiles * sizeof(uint64_t)),
+			.ignition_ticks = allocate_in_arena(arena, n_tiles * sizeof(long long)),
+			.active = allocate_in_arena(arena, n_tiles * sizeof(int)),
+			.n_active = 0,
+			.next = allocate_in_arena(arena, n_tiles * sizeof(int)),
+			.arena = arena
+	};
+	seed_random(&grid.random, seed);
+
+	Tile * tiles = terrain[0];
+	for (size_t i = 0; i < n_tiles; i++) {
+		grid.types[i] = tiles[i].current_type;
+
+		if (tiles[i].current_type == FIRE) {
+			grid.burning[i] = grid.mask;
+			grid.changed[i] = tiles[i].state ? grid.mask : 0;
+			grid.touched[i] = grid.mask;
+			grid.ignition_ticks[i] = (long long) max(tiles[i].ignition_tick, 0) * n_replicas;
+			grid.active[grid.n_active++] = (int) i;
+		}
+	}
+
+	return grid;
+}
+
+/**
+ * Get the inverse of the probability for a tile to be set on fire by a neighbor, as in get_model
+ *
+ * @param grid The replicas
+ * @param index The index of the tile
+ * @param diagonal Whether the neighbor is a diagonal one
+ * @return The inverse of the probability (0 if the tile cannot burn)
+ */
+int get_bitsliced_burn(BitslicedGrid * grid, int index, bool diagonal) {
+	TileType type = grid->types[index];
+
+	if (type == TREE) {
+		return grid->model == 0 ? M0_PROBA_TREE_BURN : diagonal ? M1_D_PROBA_TREE_BURN : M1_C_PROBA_TREE_BURN;
+	} else if (type == GRASS) {
+		return grid->model == 0 ? M0_PROBA_GRASS_BURN : diagonal ? M1_D_PROBA_GRASS_BURN : M1_C_PROBA_GRASS_BURN;
+	}
+
+	return 0;
+}
+
+/**
+ * Update the replicas, following the rules of tick
+ *
+ * @param grid The replicas
+ */
+void tick_bitsliced(BitslicedGrid * grid) {
+	PROFILE_BEGIN(PHASE_TICK);
+	grid->n_ticks++;
+	add_live_counter(LIVE_TICKS, 1);
+
+	int size = grid->size;
+	int n_ignited = 0;
+	int n_changes = grid->model == 1 ? 2 : 1;
+
+	for (int a = 0; a < grid->n_active; a++) {
+		int index = grid->active[a];
+		int x = index / size;
+		int y = index % size;
+		uint64_t burning = grid->burning[index];
+
+		// First step, spread the fire to the neighbors from the current state
+		int n_neighbors = grid->model == 1 ? 8 : 4;
+		for (int k = 0; k < n_neighbors; k++) {
+			static const int dx[8] = {-1, 1, 0, 0, -1, 1, -1, 1};
+			static const int dy[8] = {0, 0, -1, 1, -1, -1, 1, 1};
+			int nx = x + dx[k];
+			int ny = y + dy[k];
+			if (nx < 0 || nx >= size || ny < 0 || ny >= size) {
+				continue;
+			}
+
+			int neighbor = nx * size + ny;
+			int proba = get_bitsliced_burn(grid, neighbor, k >= 4);
+			uint64_t candidates = burning & ~grid->touched[neighbor];
+			if (proba == 0 || candidates == 0) {
+				continue;
+			}
+
+			uint64_t ignited = candidates & get_bernoulli_word(&grid->random, proba);
+			if (ignited != 0) {
+				// The tiles set on fire are listed the first time they are set on fire during the tick
+				if (grid->ignited[neighbor] == 0) {
+					grid->next[n_ignited++] = neighbor;
+				}
+				grid->ignited[neighbor] |= ignited;
+			}
+		}
+
+		// Second step, change the state of the tile : a new fire changes state, then burns out (the model 1 applies
+		// the change twice per tick, in its passes over the direct and the diagonal neighbors)
+		uint64_t change = 0;
+		for (int c = 0; c < n_changes; c++) {
+			change |= get_bernoulli_word(&grid->random, grid->model == 0 ? M0_PROBA_STATE_CHANGE :
+																	  M1_PROBA_STATE_CHANGE);
+		}
+		uint64_t burnt = burning & grid->changed[index] & change;
+		grid->changed[index] = (grid->changed[index] | (burning & change)) & ~burnt;
+		grid->burning[index] = burning & ~burnt;
+	}
+
+	// The tiles still on fire stay active
+	int n_active = 0;
+	for (int a = 0; a < grid->n_active; a++) {
+		if (grid->burning[grid->active[a]]) {
+			grid->active[n_active++] = grid->active[a];
+		}
+	}
+
+	// The tiles set on fire are added, they spread from the next tick
+	for (int i = 0; i < n_ignited; i++) {
+		int index = grid->next[i];
+		uint64_t ignited = grid->ignited[index];
+
+		if (grid->burning[index] == 0) {
+			grid->active[n_active++] = index;
+		}
+		grid->burning[index] |= ignited;
+		grid->touched[index] |= ignited;
+		grid->ignition_ticks[index] += (long long) grid->n_ticks * __builtin_popcountll(ignited);
+		grid->ignited[index] = 0;
+	}
+	grid->n_active = n_active;
+
+	PROFILE_END(PHASE_TICK);
+}
+
+/**
+ * Run replicas until they all end
+ *
+ * @param grid The replicas
+ * @param max_ticks The max number of ticks to run (-1 to run until the end)
+ * @return The number of ticks that were run
+ */
+int run_bitsliced_grid(BitslicedGrid * grid, int max_ticks) {
+	int ticks = 0;
+
+	while (grid->n_active > 0 && ticks != max_ticks) {
+		tick_bitsliced(grid);
+		ticks++;
+	}
+
+	return ticks;
+}
+
+/**
+ * Add the current state of the replicas to an ensemble, as add_to_ensemble does for each replica
+ *
+ * @param ensemble The ensemble
+ * @param grid The replicas (of the same size as the ensemble)
+ */
+void add_bitsliced_to_ensemble(Ensemble * ensemble, BitslicedGrid grid) {
+	size_t n_tiles = (size_t) grid.size * grid.size;
+	int n_replicas = __builtin_popcountll(grid.mask);
+
+	for (size_t i = 0; i < n_tiles; i++) {
+		int burning = __builtin_popcountll(grid.burning[i]);
+		int touched = __builtin_popcountll(grid.touched[i]);
+
+		ensemble->types[i * TILE_TYPE_SIZE + FIRE] += burning;
+		ensemble->types[i * TILE_TYPE_SIZE + BURNT] += touched - burning;
+		ensemble->types[i * TILE_TYPE_SIZE + grid.types[i]] += n_replicas - touched;
+		ensemble->burns[i] += touched;
+		ensemble->ignition_ticks[i] += grid.ignition_ticks[i];
+	}
+
+	ensemble->count += n_replicas;
+}
+
+/**
+ * Destroy bit-sliced replicas
+ *
+ * @param grid The replicas to destroy
+ */
+void destroy_bitsliced_grid(BitslicedGrid grid) {
+	destroy_arena(grid.arena);
+}
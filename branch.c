@@ -0,0 +1,141 @@
+#pragma once
+#include "sweep.c"
+
+/**
+ * Represents a branch forked from the state of a grid
+ */
+typedef struct {
+	/**
+	 * The grid the branch is forked from
+	 */
+	Grid * parent;
+	/**
+	 * The wind speed of the branch
+	 */
+	double wind_speed;
+	/**
+	 * The wind direction of the branch
+	 */
+	double wind_direction;
+	/**
+	 * The replica of the branch
+	 */
+	int replica;
+	/**
+	 * The seed of the branch
+	 */
+	uint64_t seed;
+	/**
+	 * The max number of ticks after the fork (-1 to run until the end)
+	 */
+	int max_ticks;
+	/**
+	 * The number of ticks that were run after the fork
+	 */
+	int ticks;
+	/**
+	 * The statistics of the branch at the end of the run
+	 */
+	Statistics statistics;
+} Branch;
+
+/**
+ * Run a branch (run by the workers)
+ *
+ * @param argument The branch
+ */
+void run_branch(void * argument) {
+	Branch * branch = argument;
+
+	Grid grid = fork_grid(branch->parent, branch->seed);
+	set_wind(&grid, branch->wind_direction, branch->wind_speed);
+
+	branch->ticks = run_grid(&grid, branch->max_ticks);
+	branch->statistics = grid.statistics;
+
+	destroy_grid(grid);
+}
+
+/**
+ * Run what-if branches : a grid is run until a tick, then forked into one branch per combination of wind speed, wind
+ * direction and replica, summarized in branches.csv
+ * <p>
+ * The ticks before the fork are simulated once. The replica r of every combination uses the seed seed + 1 + r, so the
+ * combinations are compared with the same random numbers.
+ * </p>
+ *
+ * @param model The model of the grid
+ * @param wind_direction The wind direction before the fork
+ * @param wind_speed The wind speed before the fork
+ * @param branch_tick The tick of the fork
+ * @param wind_speeds The wind speeds of the branches
+ * @param wind_directions The wind directions of the branches
+ * @param replicas The number of branches per combination
+ * @param max_ticks The max number of ticks of a branch after the fork (-1 to run until the end)
+ * @param n_threads The number of worker threads (the number of processors if not positive)
+ * @param seed The seed of the terrain and of the grid before the fork
+ * @return The exit code
+ */
+int run_branches(int model, double wind_direction, double wind_speed, int branch_tick, const char * wind_speeds,
+				 const char * wind_directions, int replicas, int max_ticks, int n_threads, uint64_t seed) {
+	double * speed_values;
+	double * direction_values;
+	int n_speeds = parse_values(wind_speeds, &speed_values);
+	int n_directions = parse_values(wind_directions, &direction_values);
+	replicas = max(replicas, 1);
+	int n_branches = n_speeds * n_directions * replicas;
+
+	Grid parent = create_grid(model, GRID_SIZE, seed, (Window) {.window = NULL, .surface = NULL}, 0, 0, false,
+							  false);
+	parent.wind_direction = wind_direction;
+	parent.wind_speed = wind_speed;
+	int ticks = run_grid(&parent, branch_tick);
+
+	printf("Forking %d branches at tick %d (burning %d, burned %d)\n", n_branches, ticks,
+		   parent.statistics.burning, parent.statistics.burned);
+	fflush(stdout);
+
+	ThreadPool * pool = create_thread_pool(n_threads);
+	Branch * branches = malloc(n_branches * sizeof(*branches));
+	for (int s = 0; s < n_speeds; s++) {
+		for (int d = 0; d < n_directions; d++) {
+			for (int r = 0; r < replicas; r++) {
+				Branch * branch = &branches[(s * n_directions + d) * replicas + r];
+				*branch = (Branch) {
+						.parent = &parent,
+						.wind_speed = speed_values[s],
+						.wind_direction = direction_values[d],
+						.replica = r,
+						.seed = seed + 1 + r,
+						.max_ticks = max_ticks
+				};
+				submit_task(pool, run_branch, branch);
+			}
+		}
+	}
+	wait_thread_pool(pool);
+
+	FILE * fp = fopen("branches.csv", "w");
+	if (!fp) {
+		fprintf(stderr, "Failed to open file branches.csv for writing\n");
+	} else {
+		fprintf(fp, "wind_speed,wind_direction,replica,fork_tick,ticks,burning,burned,perimeter,spread\n");
+
+		for (int i = 0; i < n_branches; i++) {
+			Branch branch = branches[i];
+			fprintf(fp, "%g,%g,%d,%d,%d,%d,%d,%d,%.3f\n", branch.wind_speed, branch.wind_direction, branch.replica,
+					ticks, branch.ticks, branch.statistics.burning, branch.statistics.burned,
+					branch.statistics.perimeter, branch.statistics.front - branch.statistics.origin);
+		}
+
+		fclose(fp);
+	}
+
+	destroy_thread_pool(pool);
+	free(branches);
+	destroy_grid(parent);
+	free(speed_values);
+	free(direction_values);
+
+	return fp ? 0 : 1;
+}
@@ -0,0 +1,438 @@
+#pragma once
+#include <pthread.h>
+#include <signal.h>
+#include "ensemble.c"
+
+/**
+ * The magic number at the start of a checkpoint file
+ */
+const char CHECKPOINT_MAGIC[8] = {'T', 'I', 'P', 'E', 'C', 'K', 'P', 'T'};
+/**
+ * The version of the checkpoint format
+ */
+const int CHECKPOINT_VERSION = 3;
+
+/**
+ * Represents the state of the main loop, saved in a checkpoint alongside the grids
+ */
+typedef struct {
+	/**
+	 * The number of grids
+	 */
+	int count;
+	/**
+	 * The max number of iterations in one interval
+	 */
+	int iterations;
+	/**
+	 * The max number of intervals
+	 */
+	int intervals;
+	/**
+	 * The current interval
+	 */
+	int n_intervals;
+	/**
+	 * The iterations left in the current interval, as counted by the main loop
+	 */
+	int iterations_left;
+	/**
+	 * The number of grids that have not ended
+	 */
+	int remaining;
+	/**
+	 * The model of the grids
+	 */
+	int model;
+	/**
+	 * The wind direction
+	 */
+	double wind_direction;
+	/**
+	 * The wind speed
+	 */
+	double wind_speed;
+	/**
+	 * Whether the final states are aggregated into an ensemble
+	 */
+	bool generate_mean;
+	/**
+	 * The seed of the run, the grid i uses seed + i
+	 */
+	uint64_t seed;
+} RunState;
+
+/**
+ * Set when a checkpoint is requested by a signal (SIGUSR1)
+ */
+volatile sig_atomic_t checkpoint_requested = 0;
+
+/**
+ * Request a checkpoint (signal handler)
+ *
+ * @param sig The signal (always SIGUSR1)
+ */
+void request_checkpoint(int sig) {
+	(void) sig;
+	checkpoint_requested = 1;
+}
+
+/**
+ * Write the state of a grid to a checkpoint file
+ *
+ * @param fp The checkpoint file
+ * @param grid The grid
+ * @return True if the grid was written, false otherwise
+ */
+bool write_grid_state(FILE * fp, Grid * grid) {
+	// Ended grids without exports have been released, only their position is kept. Ended grids with exports still
+	// hold their final state, exported at the next intervals
+	bool has_tiles = grid->data != NULL;
+	bool ok = fwrite(&grid->ended, sizeof(grid->ended), 1, fp) == 1 &&
+			  fwrite(&grid->coord_x, sizeof(grid->coord_x), 1, fp) == 1 &&
+			  fwrite(&grid->coord_y, sizeof(grid->coord_y), 1, fp) == 1 &&
+			  fwrite(&has_tiles, sizeof(has_tiles), 1, fp) == 1;
+	if (!ok || !has_tiles) {
+		return ok;
+	}
+
+	size_t n_tiles = (size_t) grid->size * grid->size;
+
+	return fwrite(&grid->size, sizeof(grid->size), 1, fp) == 1 &&
+		   fwrite(&grid->model, sizeof(grid->model), 1, fp) == 1 &&
+		   fwrite(&grid->export_png, sizeof(grid->export_png), 1, fp) == 1 &&
+		   fwrite(&grid->export_csv, sizeof(grid->export_csv), 1, fp) == 1 &&
+		   fwrite(&grid->wind_direction, sizeof(grid->wind_direction), 1, fp) == 1 &&
+		   fwrite(&grid->wind_speed, sizeof(grid->wind_speed), 1, fp) == 1 &&
+		   fwrite(&grid->n_intervals, sizeof(grid->n_intervals), 1, fp) == 1 &&
+		   fwrite(&grid->n_ticks, sizeof(grid->n_ticks), 1, fp) == 1 &&
+		   fwrite(&grid->random, sizeof(grid->random), 1, fp) == 1 &&
+		   fwrite(&grid->statistics, sizeof(grid->statistics), 1, fp) == 1 &&
+		   fwrite(grid->data[0], sizeof(Tile), n_tiles, fp) == n_tiles;
+}
+
+/**
+ * Read the state of a grid from a checkpoint file
+ *
+ * @param fp The checkpoint file
+ * @param grid The grid to fill
+ * @param window The window to draw the grid
+ * @return True if the grid was read, false otherwise
+ */
+bool read_grid_state(FILE * fp, Grid * grid, Window window) {
+	*grid = (Grid) {
+			.data = NULL,
+			.scratch = NULL,
+			.window = window
+	};
+
+	bool has_tiles;
+	bool ok = fread(&grid->ended, sizeof(grid->ended), 1, fp) == 1 &&
+			  fread(&grid->coord_x, sizeof(grid->coord_x), 1, fp) == 1 &&
+			  fread(&grid->coord_y, sizeof(grid->coord_y), 1, fp) == 1 &&
+			  fread(&has_tiles, sizeof(has_tiles), 1, fp) == 1;
+	if (!ok || !has_tiles) {
+		return ok;
+	}
+
+	if (fread(&grid->size, sizeof(grid->size), 1, fp) != 1 || grid->size <= 0) {
+		return false;
+	}
+
+	size_t n_tiles = (size_t) grid->size * grid->size;
+	grid->arena = create_grid_arena(grid->size);
+	grid->data = allocate_tiles_in(grid->arena, grid->size);
+	grid->scratch = allocate_tiles_in(grid->arena, grid->size);
+
+	ok = fread(&grid->model, sizeof(grid->model), 1, fp) == 1 &&
+		 fread(&grid->export_png, sizeof(grid->export_png), 1, fp) == 1 &&
+		 fread(&grid->export_csv, sizeof(grid->export_csv), 1, fp) == 1 &&
+		 fread(&grid->wind_direction, sizeof(grid->wind_direction), 1, fp) == 1 &&
+		 fread(&grid->wind_speed, sizeof(grid->wind_speed), 1, fp) == 1 &&
+		 fread(&grid->n_intervals, sizeof(grid->n_intervals), 1, fp) == 1 &&
+		 fread(&grid->n_ticks, sizeof(grid->n_ticks), 1, fp) == 1 &&
+		 fread(&grid->random, sizeof(grid->random), 1, fp) == 1 &&
+		 fread(&grid->statistics, sizeof(grid->statistics), 1, fp) == 1 &&
+		 fread(grid->data[0], sizeof(Tile), n_tiles, fp) == n_tiles;
+
+	// The spread table only depends on the wind, so it is computed again
+	grid->spread = create_spread_table(grid->wind_direction, grid->wind_speed);
+
+	if (ok) {
+		allocate_blocks(grid);
+		count_block_fires(grid);
+	} else {
+		release_arena(grid->arena);
+		grid->arena = NULL;
+		grid->data = NULL;
+		grid->scratch = NULL;
+	}
+
+	return ok;
+}
+
+/**
+ * Write a checkpoint file : the state of the main loop, the grids and the ensemble
+ * <p>
+ * The file is written next to its final path and renamed once complete, so a checkpoint is never left half written.
+ * The format is the memory layout of this build, checkpoints are meant to be restored on the same kind of machine.
+ * </p>
+ *
+ * @param path The path of the checkpoint file
+ * @param state The state of the main loop
+ * @param grids The grids
+ * @param ensemble The ensemble (used only if state.generate_mean)
+ * @return True if the checkpoint was written, false otherwise
+ */
+bool save_checkpoint(const char * path, RunState state, Grid * grids, Ensemble * ensemble) {
+	char * temporary_path = malloc(strlen(path) + 5);
+	sprintf(temporary_path, "%s.tmp", path);
+
+	FILE * fp = fopen(temporary_path, "wb");
+	if (!fp) {
+		fprintf(stderr, "Failed to open file %s for writing\n", temporary_path);
+		free(temporary_path);
+		return false;
+	}
+
+	bool ok = fwrite(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC), 1, fp) == 1 &&
+			  fwrite(&CHECKPOINT_VERSION, sizeof(CHECKPOINT_VERSION), 1, fp) == 1 &&
+			  fwrite(&state, sizeof(state), 1, fp) == 1;
+
+	for (int i = 0; ok && i < state.count; i++) {
+		ok = write_grid_state(fp, &grids[i]);
+	}
+
+	if (ok && state.generate_mean) {
+		size_t n_tiles = (size_t) ensemble->size * ensemble->size;
+
+		ok = fwrite(&ensemble->size, sizeof(ensemble->size), 1, fp) == 1 &&
+			 fwrite(&ensemble->count, sizeof(ensemble->count), 1, fp) == 1 &&
+			 fwrite(ensemble->types, sizeof(*ensemble->types), n_tiles * TILE_TYPE_SIZE, fp) ==
+			 n_tiles * TILE_TYPE_SIZE &&
+			 fwrite(ensemble->burns, sizeof(*ensemble->burns), n_tiles, fp) == n_tiles &&
+			 fwrite(ensemble->ignition_ticks, sizeof(*ensemble->ignition_ticks), n_tiles, fp) == n_tiles;
+	}
+
+	ok = fclose(fp) == 0 && ok && rename(temporary_path, path) == 0;
+	if (!ok) {
+		fprintf(stderr, "Failed to write checkpoint %s\n", path);
+		remove(temporary_path);
+	}
+
+	free(temporary_path);
+
+	return ok;
+}
+
+/**
+ * Load a checkpoint file written by save_checkpoint
+ *
+ * @param path The path of the checkpoint file
+ * @param state The state of the main loop to fill
+ * @param grids The loaded grids, to free
+ * @param ensemble The loaded ensemble (only if state->generate_mean)
+ * @param window The window to draw the grids
+ * @return True if the checkpoint was loaded, false otherwise
+ */
+bool load_checkpoint(const char * path, RunState * state, Grid ** grids, Ensemble * ensemble, Window window) {
+	FILE * fp = fopen(path, "rb");
+	if (!fp) {
+		fprintf(stderr, "Failed to open file %s for reading\n", path);
+		return false;
+	}
+
+	char magic[sizeof(CHECKPOINT_MAGIC)];
+	int version;
+	bool ok = fread(magic, sizeof(magic), 1, fp) == 1 && memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) == 0 &&
+			  fread(&version, sizeof(version), 1, fp) == 1 && version == CHECKPOINT_VERSION &&
+			  fread(state, sizeof(*state), 1, fp) == 1 && state->count > 0;
+
+	*grids = ok ? calloc(state->count, sizeof(**grids)) : NULL;
+	for (int i = 0; ok && i < state->count; i++) {
+		ok = read_grid_state(fp, &(*grids)[i], window);
+	}
+
+	if (ok && state->generate_mean) {
+		int size;
+		ok = fread(&size, sizeof(size), 1, fp) == 1 && size > 0;
+
+		if (ok) {
+			size_t n_tiles = (size_t) size * size;
+
+			*ensemble = create_ensemble(size);
+			ok = fread(&ensemble->count, sizeof(ensemble->count), 1, fp) == 1 &&
+				 fread(ensemble->types, sizeof(*ensemble->types), n_tiles * TILE_TYPE_SIZE, fp) ==
+				 n_tiles * TILE_TYPE_SIZE &&
+				 fread(ensemble->burns, sizeof(*ensemble->burns), n_tiles, fp) == n_tiles &&
+				 fread(ensemble->ignition_ticks, sizeof(*ensemble->ignition_ticks), n_tiles, fp) == n_tiles;
+
+			if (!ok) {
+				destroy_ensemble(*ensemble);
+			}
+		}
+	}
+
+	fclose(fp);
+
+	if (!ok) {
+		fprintf(stderr, "Invalid checkpoint %s\n", path);
+
+		if (*grids) {
+			for (int i = 0; i < state->count; i++) {
+				// The grids read before the error are released without being exported
+				if ((*grids)[i].data) {
+					destroy_grid((Grid) {.data = (*grids)[i].data, .scratch = (*grids)[i].scratch,
+										 .arena = (*grids)[i].arena});
+				}
+			}
+			free(*grids);
+			*grids = NULL;
+		}
+	}
+
+	return ok;
+}
+
+/**
+ * Represents the background writer of the checkpoints
+ */
+typedef struct {
+	/**
+	 * The thread writing the last checkpoint
+	 */
+	pthread_t thread;
+	/**
+	 * Whether a checkpoint was started
+	 */
+	bool started;
+	/**
+	 * Whether the last checkpoint is written
+	 */
+	bool done;
+	/**
+	 * The lock protecting done
+	 */
+	pthread_mutex_t lock;
+	/**
+	 * The path of the checkpoint file
+	 */
+	const char * path;
+	/**
+	 * The snapshot of the state of the main loop
+	 */
+	RunState state;
+	/**
+	 * The snapshot of the grids
+	 */
+	Grid * grids;
+	/**
+	 * The snapshot of the ensemble (only if state.generate_mean)
+	 */
+	Ensemble ensemble;
+} CheckpointWriter;
+
+/**
+ * Create a checkpoint writer
+ *
+ * @param path The path of the checkpoint file
+ * @return The created writer, to destroy with destroy_checkpoint_writer
+ */
+CheckpointWriter * create_checkpoint_writer(const char * path) {
+	CheckpointWriter * writer = malloc(sizeof(*writer));
+	*writer = (CheckpointWriter) {
+			.started = false,
+			.done = true,
+			.path = path,
+			.grids = NULL
+	};
+	pthread_mutex_init(&writer->lock, NULL);
+
+	return writer;
+}
+
+/**
+ * Write the snapshot of a writer and release it (run by the writer thread)
+ *
+ * @param argument The writer
+ * @return NULL
+ */
+void * run_checkpoint_writer(void * argument) {
+	CheckpointWriter * writer = argument;
+
+	save_checkpoint(writer->path, writer->state, writer->grids, &writer->ensemble);
+
+	for (int i = 0; i < writer->state.count; i++) {
+		if (writer->grids[i].data) {
+			free_tiles(writer->grids[i].data);
+		}
+	}
+	free(writer->grids);
+	if (writer->state.generate_mean) {
+		destroy_ensemble(writer->ensemble);
+	}
+
+	add_live_counter(LIVE_EXPORT_QUEUE, -1);
+	pthread_mutex_lock(&writer->lock);
+	writer->done = true;
+	pthread_mutex_unlock(&writer->lock);
+
+	return NULL;
+}
+
+/**
+ * Start a checkpoint in the background, so the main loop is not stalled : the grids are copied and the copy is
+ * written by another thread
+ *
+ * @param writer The writer
+ * @param state The state of the main loop
+ * @param grids The grids
+ * @param ensemble The ensemble (used only if state.generate_mean)
+ * @return True if the checkpoint was started, false if the previous one is still being written
+ */
+bool start_checkpoint(CheckpointWriter * writer, RunState state, Grid * grids, Ensemble * ensemble) {
+	pthread_mutex_lock(&writer->lock);
+	bool done = writer->done;
+	pthread_mutex_unlock(&writer->lock);
+
+	if (!done) {
+		return false;
+	}
+	if (writer->started) {
+		pthread_join(writer->thread, NULL);
+	}
+
+	writer->state = state;
+	writer->grids = malloc(state.count * sizeof(*writer->grids));
+	for (int i = 0; i < state.count; i++) {
+		writer->grids[i] = grids[i];
+		if (grids[i].data) {
+			writer->grids[i].data = copy_grid(grids[i].data, grids[i].size);
+		}
+	}
+	if (state.generate_mean) {
+		writer->ensemble = create_ensemble(ensemble->size);
+		merge_ensemble(&writer->ensemble, *ensemble);
+	}
+
+	writer->started = true;
+	writer->done = false;
+	add_live_counter(LIVE_EXPORT_QUEUE, 1);
+	pthread_create(&writer->thread, NULL, run_checkpoint_writer, writer);
+
+	return true;
+}
+
+/**
+ * Destroy a checkpoint writer, once the last checkpoint is written
+ *
+ * @param writer The writer to destroy
+ */
+void destroy_checkpoint_writer(CheckpointWriter * writer) {
+	if (writer->started) {
+		pthread_join(writer->thread, NULL);
+	}
+
+	pthread_mutex_destroy(&writer->lock);
+	free(writer);
+}
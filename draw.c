@@ -2,6 +2,13 @@
 #include <unistd.h>
 #include "typings.c"
 #include "misc.c"
+#include "profile.c"
+
+/**
+ * The number of columns of tiles drawn or exported together : the images are laid out by rows of pixels (y) while the
+ * tiles are stored by rows of x, so a band of columns is read in storage order and written to a few rows of pixels
+ */
+const int BAND_SIZE = 16;
 
 /**
  * Draw a pixel on the window
@@ -63,20 +70,26 @@ void draw_grid(Window window, Grid grid) {
 		return;
 	}
 
+	PROFILE_BEGIN(PHASE_DRAW);
+
 	// Draw the grid using the constants defined in typings.c, and translate the grid to the right position
-	for (int i = 0; i < GRID_SIZE; i++) {
-		for (int j = 0; j < GRID_SIZE; j++) {
-			Tile tile = grid.data[i][j];
-
-			// Draw the tile as a square
-			draw_square(window, (Point) {TILE_SIZE * (i + (GRID_SIZE + 1) * grid.coord_x),
-										 TILE_SIZE * (j + (GRID_SIZE + 1) * grid.coord_y)}, TILE_SIZE,
-						get_color(tile.current_type, tile.state), false);
+	for (int band = 0; band < grid.size; band += BAND_SIZE) {
+		for (int i = 0; i < grid.size; i++) {
+			for (int j = band; j < min(grid.size, band + BAND_SIZE); j++) {
+				Tile tile = grid.data[i][j];
+
+				// Draw the tile as a square
+				draw_square(window, (Point) {TILE_SIZE * (i + (grid.size + 1) * grid.coord_x),
+											 TILE_SIZE * (j + (grid.size + 1) * grid.coord_y)}, TILE_SIZE,
+							get_color(tile.current_type, tile.state), false);
+			}
 		}
 	}
 
 	// Update the window to display the grid
 	SDL_UpdateWindowSurface(window.window);
+
+	PROFILE_END(PHASE_DRAW);
 }
 
 /**
@@ -129,7 +142,9 @@ Window create_window(int max_x, int max_y) {
  * @param ms The number of milliseconds to wait
  */
 void wait(int ms) {
+	PROFILE_BEGIN(PHASE_WAIT);
 	usleep(ms * 1000);
+	PROFILE_END(PHASE_WAIT);
 }
 
 /**
@@ -0,0 +1,184 @@
+#pragma once
+#include "grid.c"
+
+/**
+ * Create an empty ensemble
+ *
+ * @param size The size of the grids of the ensemble
+ * @return The created ensemble, to destroy with destroy_ensemble
+ */
+Ensemble create_ensemble(int size) {
+	size_t n_tiles = (size_t) size * size;
+	size_t types_size = n_tiles * TILE_TYPE_SIZE * sizeof(int);
+	size_t burns_size = n_tiles * sizeof(int);
+	size_t ignition_ticks_size = n_tiles * sizeof(long long);
+
+	// The arrays share one arena, which is mapped zeroed
+	Arena * arena = create_arena(align_size(types_size, ARENA_ALIGNMENT) + align_size(burns_size, ARENA_ALIGNMENT) +
+								 align_size(ignition_ticks_size, ARENA_ALIGNMENT));
+
+	return (Ensemble) {
+			.size = size,
+			.count = 0,
+			.types = allocate_in_arena(arena, types_size),
+			.burns = allocate_in_arena(arena, burns_size),
+			.ignition_ticks = allocate_in_arena(arena, ignition_ticks_size),
+			.arena = arena
+	};
+}
+
+/**
+ * Add the current state of a grid to an ensemble, the grid can be destroyed right after
+ *
+ * @param ensemble The ensemble
+ * @param grid The grid to add (of the same size as the ensemble)
+ */
+void add_to_ensemble(Ensemble * ensemble, Grid grid) {
+	// The tiles are contiguous, so they are read in a single pass
+	Tile * tiles = grid.data[0];
+	size_t n_tiles = (size_t) ensemble->size * ensemble->size;
+
+	for (size_t i = 0; i < n_tiles; i++) {
+		ensemble->types[i * TILE_TYPE_SIZE + tiles[i].current_type]++;
+
+		if (tiles[i].ignition_tick >= 0) {
+			ensemble->burns[i]++;
+			ensemble->ignition_ticks[i] += tiles[i].ignition_tick;
+		}
+	}
+
+	ensemble->count++;
+}
+
+/**
+ * Merge an ensemble into another one (for example the partial ensemble of a thread into the global one)
+ *
+ * @param ensemble The ensemble to merge into
+ * @param other The ensemble to merge (of the same size)
+ */
+void merge_ensemble(Ensemble * ensemble, Ensemble other) {
+	size_t n_tiles = (size_t) ensemble->size * ensemble->size;
+
+	for (size_t i = 0; i < n_tiles * TILE_TYPE_SIZE; i++) {
+		ensemble->types[i] += other.types[i];
+	}
+
+	for (size_t i = 0; i < n_tiles; i++) {
+		ensemble->burns[i] += other.burns[i];
+		ensemble->ignition_ticks[i] += other.ignition_ticks[i];
+	}
+
+	ensemble->count += other.count;
+}
+
+/**
+ * Get the most frequent final type of a tile of an ensemble
+ *
+ * @param ensemble The ensemble
+ * @param index The index of the tile (x * size + y)
+ * @return The most frequent type (the lowest one in case of a tie)
+ */
+TileType get_mode(Ensemble ensemble, size_t index) {
+	int * types = &ensemble.types[index * TILE_TYPE_SIZE];
+	int max_type = 0;
+
+	for (int i = 1; i < TILE_TYPE_SIZE; i++) {
+		if (types[i] > types[max_type]) {
+			max_type = i;
+		}
+	}
+
+	return max_type;
+}
+
+/**
+ * Create a grid holding the most frequent final type of each tile of an ensemble
+ *
+ * @param ensemble The ensemble
+ * @param model The model of the grids
+ * @param window The window of the grids
+ * @param export_csv Whether to save the content into a csv file
+ * @param export_png Whether to save the content into a png file
+ * @return The created grid, to destroy with destroy_grid
+ */
+Grid create_mean_grid(Ensemble ensemble, int model, Window window, bool export_csv, bool export_png) {
+	Arena * arena = acquire_arena(get_tiles_memory(ensemble.size));
+	Tile ** tiles = allocate_tiles_in(arena, ensemble.size);
+	size_t n_tiles = (size_t) ensemble.size * ensemble.size;
+
+	for (size_t i = 0; i < n_tiles; i++) {
+		tiles[0][i] = (Tile) {
+				.default_type = TILE_TYPE_SIZE,
+				.current_type = get_mode(ensemble, i),
+				.state = 0,
+				.ignition_tick = -1
+		};
+	}
+
+	return (Grid) {
+			.data = tiles,
+			.scratch = NULL,
+			.arena = arena,
+			.size = ensemble.size,
+			.window = window,
+			.model = model,
+			.ended = true,
+			.coord_x = -1,
+			.coord_y = -1,
+			.export_png = export_png,
+			.export_csv = export_csv
+	};
+}
+
+/**
+ * Write an ensemble to a csv file : for each tile its most frequent type, its burn frequency and its mean ignition
+ * tick (-1 if it never burnt)
+ *
+ * @param ensemble The ensemble to write
+ * @param file_name The name of the file
+ */
+void write_ensemble_csv(Ensemble ensemble, const char * file_name) {
+	FILE * fp = fopen(file_name, "w");
+	if (!fp) {
+		fprintf(stderr, "Failed to open file %s for writing\n", file_name);
+		return;
+	}
+
+	fprintf(fp, "x,y,mode,burn_frequency,mean_ignition_tick\n");
+
+	for (int x = 0; x < ensemble.size; x++) {
+		for (int y = 0; y < ensemble.size; y++) {
+			size_t i = (size_t) x * ensemble.size + y;
+			int burns = ensemble.burns[i];
+
+			fprintf(fp, "%d,%d,%d,%.4f,%.2f\n", x, y, get_mode(ensemble, i),
+					ensemble.count ? (double) burns / ensemble.count : 0.,
+					burns ? (double) ensemble.ignition_ticks[i] / burns : -1.);
+		}
+	}
+
+	fclose(fp);
+}
+
+/**
+ * Clear an ensemble, to reuse it for other grids
+ *
+ * @param ensemble The ensemble to clear
+ */
+void clear_ensemble(Ensemble * ensemble) {
+	size_t n_tiles = (size_t) ensemble->size * ensemble->size;
+
+	memset(ensemble->types, 0, n_tiles * TILE_TYPE_SIZE * sizeof(*ensemble->types));
+	memset(ensemble->burns, 0, n_tiles * sizeof(*ensemble->burns));
+	memset(ensemble->ignition_ticks, 0, n_tiles * sizeof(*ensemble->ignition_ticks));
+	ensemble->count = 0;
+}
+
+/**
+ * Destroy an ensemble
+ *
+ * @param ensemble The ensemble to destroy
+ */
+void destroy_ensemble(Ensemble ensemble) {
+	destroy_arena(ensemble.arena);
+}
@@ -0,0 +1,256 @@
+#pragma once
+#include <time.h>
+#include "ensemble.c"
+
+/**
+ * Create the terrain of a coarse grid, each tile aggregating a block of factor x factor tiles : the most frequent
+ * types and the mean altitude of the block, on fire if a tile of the block is on fire
+ * <p>
+ * The slopes are computed between neighbors one tile apart, while the centers of two coarse tiles are factor tiles
+ * apart, so the altitudes are divided by factor to keep the gradient of the map.
+ * </p>
+ *
+ * @param data The tiles of the map
+ * @param size The size of the map
+ * @param factor The size of the blocks
+ * @return The coarse tiles (ceil(size / factor) per side), to free with free_tiles
+ */
+Tile ** create_coarse_terrain(Tile ** data, int size, int factor) {
+	int coarse_size = (size + factor - 1) / factor;
+	Tile ** coarse = allocate_tiles(coarse_size);
+
+	for (int cx = 0; cx < coarse_size; cx++) {
+		for (int cy = 0; cy < coarse_size; cy++) {
+			int default_counts[TILE_TYPE_SIZE] = {0};
+			int current_counts[TILE_TYPE_SIZE] = {0};
+			double altitude = 0;
+			int n_tiles = 0;
+
+			for (int x = cx * factor; x < min((cx + 1) * factor, size); x++) {
+				for (int y = cy * factor; y < min((cy + 1) * factor, size); y++) {
+					default_counts[data[x][y].default_type]++;
+					current_counts[data[x][y].current_type]++;
+					altitude += data[x][y].altitude;
+					n_tiles++;
+				}
+			}
+
+			// The lowest type wins a tie
+			int default_type = 0;
+			int current_type = 0;
+			for (int t = 1; t < TILE_TYPE_SIZE; t++) {
+				default_type = default_counts[t] > default_counts[default_type] ? t : default_type;
+				current_type = current_counts[t] > current_counts[current_type] && t != FIRE ? t : current_type;
+			}
+			bool on_fire = current_counts[FIRE] > 0;
+
+			coarse[cx][cy] = (Tile) {
+					.default_type = default_type,
+					.current_type = on_fire ? FIRE : current_type,
+					.state = 0,
+					.ignition_tick = on_fire ? 0 : -1,
+					.altitude = altitude / n_tiles / factor
+			};
+		}
+	}
+
+	return coarse;
+}
+
+/**
+ * Check whether the fire of a cropped grid reached one of its sides that are not sides of the map
+ *
+ * @param grid The cropped grid
+ * @param x The x coordinate of the crop in the map
+ * @param y The y coordinate of the crop in the map
+ * @param size The size of the map
+ * @return True if the fire may have spread further without the crop
+ */
+bool has_escaped(Grid grid, int x, int y, int size) {
+	for (int i = 0; i < grid.size; i++) {
+		if ((x > 0 && grid.data[0][i].ignition_tick >= 0) ||
+			(x + grid.size < size && grid.data[grid.size - 1][i].ignition_tick >= 0) ||
+			(y > 0 && grid.data[i][0].ignition_tick >= 0) ||
+			(y + grid.size < size && grid.data[i][grid.size - 1].ignition_tick >= 0)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Write the tiles of a cropped ensemble that burned to a csv file, in the coordinates of the map : their burn
+ * frequency and their mean ignition tick
+ *
+ * @param ensemble The ensemble of the crop
+ * @param x The x coordinate of the crop in the map
+ * @param y The y coordinate of the crop in the map
+ * @param file_name The name of the file
+ */
+void write_estimate_csv(Ensemble ensemble, int x, int y, const char * file_name) {
+	FILE * fp = fopen(file_name, "w");
+	if (!fp) {
+		fprintf(stderr, "Failed to open file %s for writing\n", file_name);
+		return;
+	}
+
+	fprintf(fp, "x,y,burn_frequency,mean_ignition_tick\n");
+
+	for (int i = 0; i < ensemble.size; i++) {
+		for (int j = 0; j < ensemble.size; j++) {
+			size_t index = (size_t) i * ensemble.size + j;
+			int burns = ensemble.burns[index];
+
+			if (burns > 0) {
+				fprintf(fp, "%d,%d,%.4f,%.2f\n", x + i, y + j, (double) burns / ensemble.count,
+						(double) ensemble.ignition_ticks[index] / burns);
+			}
+		}
+	}
+
+	fclose(fp);
+}
+
+/**
+ * Get the time elapsed since a start, in milliseconds
+ *
+ * @param start The start
+ * @return The elapsed time
+ */
+double get_elapsed_ms(struct timespec start) {
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	return (double) (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+}
+
+/**
+ * Estimate quickly where a fire goes on a large map, and write the burn frequency and the mean ignition tick of the
+ * tiles it burns to estimate.csv
+ * <p>
+ * The fire is first simulated on a coarse grid of factor x factor blocks (a coarse tick covering about factor ticks),
+ * then at full resolution on the square crop of the map holding every block reached by a coarse replica plus a
+ * margin, replicas times each. While the fire reaches a side of the crop inside the map, the margin is doubled and
+ * the full resolution pass is run again. The wind field is not supported, since it is stretched over the simulated
+ * grid.
+ * </p>
+ *
+ * @param model The model of the grids
+ * @param wind_direction The wind direction
+ * @param wind_speed The wind speed
+ * @param size The size of the map
+ * @param ignition The point set on fire, in addition to the default fire
+ * @param factor The size of the blocks of the coarse grid
+ * @param margin The margin around the blocks reached by the coarse replicas, in tiles
+ * @param replicas The number of replicas of each pass
+ * @param max_ticks The max number of ticks of the full resolution replicas (-1 to run until the end)
+ * @param seed The seed of the terrain and of the simulations
+ * @return The exit code
+ */
+int run_estimate(int model, double wind_direction, double wind_speed, int size, Point ignition, int factor, int margin,
+				 int replicas, int max_ticks, uint64_t seed) {
+	if (factor < 1 || size < 1 || replicas < 1 || margin < 0) {
+		fprintf(stderr, "Invalid estimate of a map of %d tiles with blocks of %d tiles, %d replicas and a margin of %d\n",
+				size, factor, replicas, margin);
+		return 1;
+	}
+	if (wind_field) {
+		fprintf(stderr, "The estimate does not support --wind_field\n");
+		return 1;
+	}
+
+	Grid map = create_grid(model, size, seed, (Window) {.window = NULL, .surface = NULL}, 0, 0, false, false);
+	ignite(&map, (Point) {max(0, min(size - 1, ignition.x)), max(0, min(size - 1, ignition.y))});
+
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	// The blocks reached by any coarse replica
+	int coarse_size = (size + factor - 1) / factor;
+	Tile ** coarse = create_coarse_terrain(map.data, size, factor);
+	int min_x = coarse_size;
+	int min_y = coarse_size;
+	int max_x = -1;
+	int max_y = -1;
+	for (int r = 0; r < replicas; r++) {
+		Grid grid = create_grid_from_tiles(model, coarse, coarse_size, seed + replicas + r,
+										   (Window) {.window = NULL, .surface = NULL}, 0, 0, false, false);
+		set_wind(&grid, wind_direction, wind_speed);
+		run_grid(&grid, max_ticks < 0 ? -1 : (max_ticks + factor - 1) / factor);
+
+		for (int x = 0; x < coarse_size; x++) {
+			for (int y = 0; y < coarse_size; y++) {
+				if (grid.data[x][y].ignition_tick >= 0) {
+					min_x = min(min_x, x);
+					min_y = min(min_y, y);
+					max_x = max(max_x, x);
+					max_y = max(max_y, y);
+				}
+			}
+		}
+
+		destroy_grid(grid);
+	}
+	free_tiles(coarse);
+	double coarse_ms = get_elapsed_ms(start);
+
+	if (max_x < 0) {
+		printf("No fire on the map\n");
+		destroy_grid(map);
+		return 0;
+	}
+
+	printf("Coarse pass (%d replicas of %d x %d blocks) in %.2f ms: blocks %d,%d to %d,%d reached\n", replicas,
+		   coarse_size, coarse_size, coarse_ms, min_x, min_y, max_x, max_y);
+
+	while (true) {
+		clock_gettime(CLOCK_MONOTONIC, &start);
+
+		// The smallest square holding the reached blocks and the margin, moved inside the map
+		int x0 = max(0, min_x * factor - margin);
+		int y0 = max(0, min_y * factor - margin);
+		int x1 = min(size, (max_x + 1) * factor + margin);
+		int y1 = min(size, (max_y + 1) * factor + margin);
+		int crop_size = max(x1 - x0, y1 - y0);
+		x0 = max(0, min(x0, size - crop_size));
+		y0 = max(0, min(y0, size - crop_size));
+
+		Tile ** crop = allocate_tiles(crop_size);
+		for (int x = 0; x < crop_size; x++) {
+			memcpy(crop[x], &map.data[x0 + x][y0], crop_size * sizeof(**crop));
+		}
+
+		Ensemble ensemble = create_ensemble(crop_size);
+		bool escaped = false;
+		for (int r = 0; r < replicas && !escaped; r++) {
+			Grid grid = create_grid_from_tiles(model, crop, crop_size, seed + r,
+											   (Window) {.window = NULL, .surface = NULL}, 0, 0, false, false);
+			set_wind(&grid, wind_direction, wind_speed);
+			run_grid(&grid, max_ticks);
+
+			escaped = crop_size < size && has_escaped(grid, x0, y0, size);
+			add_to_ensemble(&ensemble, grid);
+			destroy_grid(grid);
+		}
+		free_tiles(crop);
+
+		printf("Full resolution pass (%d replicas of %d x %d tiles from %d,%d, %.1f%% of the map) in %.2f ms%s\n",
+			   ensemble.count, crop_size, crop_size, x0, y0, 100. * crop_size * crop_size / ((double) size * size),
+			   get_elapsed_ms(start), escaped ? ": the fire reached a side of the crop, doubling the margin" : "");
+
+		if (escaped) {
+			destroy_ensemble(ensemble);
+			margin = max(2 * margin, factor);
+			continue;
+		}
+
+		write_estimate_csv(ensemble, x0, y0, "estimate.csv");
+		destroy_ensemble(ensemble);
+		break;
+	}
+
+	destroy_grid(map);
+
+	return 0;
+}
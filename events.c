@@ -0,0 +1,272 @@
+#pragma once
+#include <limits.h>
+#include "arrival.c"
+
+/**
+ * Represents the kind of an event of the event-driven engine
+ */
+typedef enum {
+	/**
+	 * A tile on fire sets a neighbor on fire
+	 */
+	EVENT_IGNITE,
+	/**
+	 * A new fire changes state
+	 */
+	EVENT_CHANGE,
+	/**
+	 * A fire burns out
+	 */
+	EVENT_BURN_OUT
+} EventType;
+
+/**
+ * Represents an event of the event-driven engine
+ */
+typedef struct {
+	/**
+	 * The tick of the event
+	 */
+	int tick;
+	/**
+	 * The kind of the event
+	 */
+	EventType type;
+	/**
+	 * The index of the tile of the event (x * size + y)
+	 */
+	int index;
+} Event;
+
+/**
+ * Represents the queue of the events : a binary min-heap on the tick
+ */
+typedef struct {
+	/**
+	 * The queued events
+	 */
+	Event * events;
+	/**
+	 * The number of queued events
+	 */
+	size_t count;
+	/**
+	 * The number of events the queue can hold before growing
+	 */
+	size_t capacity;
+} EventQueue;
+
+/**
+ * Queue an event
+ *
+ * @param queue The queue
+ * @param event The event
+ */
+void push_event(EventQueue * queue, Event event) {
+	if (queue->count == queue->capacity) {
+		queue->capacity = max(2 * queue->capacity, 256);
+		queue->events = realloc(queue->events, queue->capacity * sizeof(*queue->events));
+	}
+
+	size_t i = queue->count++;
+	while (i > 0 && queue->events[(i - 1) / 2].tick > event.tick) {
+		queue->events[i] = queue->events[(i - 1) / 2];
+		i = (i - 1) / 2;
+	}
+	queue->events[i] = event;
+}
+
+/**
+ * Remove the earliest event of a queue
+ *
+ * @param queue The queue (not empty)
+ * @return The earliest event
+ */
+Event pop_event(EventQueue * queue) {
+	Event first = queue->events[0];
+	Event last = queue->events[--queue->count];
+
+	size_t i = 0;
+	while (2 * i + 1 < queue->count) {
+		size_t child = 2 * i + 1;
+		if (child + 1 < queue->count && queue->events[child + 1].tick < queue->events[child].tick) {
+			child++;
+		}
+		if (queue->events[child].tick >= last.tick) {
+			break;
+		}
+
+		queue->events[i] = queue->events[child];
+		i = child;
+	}
+	queue->events[i] = last;
+
+	return first;
+}
+
+/**
+ * Check if a model can be run by the event-driven engine
+ *
+ * @param model The model
+ * @return True for the models 0, 1 and 3, whose fires try to spread and change state on every tick
+ */
+bool is_event_model(int model) {
+	return model == 0 || model == 1 || model == 3;
+}
+
+/**
+ * Get the number of ticks until the first success of a trial repeated on every tick (geometric distribution)
+ *
+ * @param random The random number generator
+ * @param probability The probability of success of a trial
+ * @return The number of ticks (at least 1), INT_MAX / 2 if the probability is too small to succeed
+ */
+int get_geometric(Random * random, double probability) {
+	if (probability >= 1) {
+		return 1;
+	}
+
+	// P(ticks <= k) = 1 - (1 - p)^k, with a uniform number in (0, 1]
+	double ticks = ceil(log(1 - get_random_3(random)) / log1p(-probability));
+
+	return ticks < 1 ? 1 : ticks > INT_MAX / 2 ? INT_MAX / 2 : (int) ticks;
+}
+
+/**
+ * Get the probability for a tile on fire to change state during one tick
+ *
+ * @param model The model
+ * @return The probability
+ */
+double get_state_change_probability(int model) {
+	if (model == 0) {
+		return 1. / M0_PROBA_STATE_CHANGE;
+	} else if (model == 1) {
+		// The change is drawn twice per tick, in the passes over the direct and the diagonal neighbors
+		return 1 - pow(1 - 1. / M1_PROBA_STATE_CHANGE, 2);
+	}
+
+	return M3_PROBA_STATE_CHANGE;
+}
+
+/**
+ * Schedule the events of a tile on fire : its state changes and the ignitions of its neighbors during its lifetime
+ *
+ * @param grid The grid
+ * @param queue The queue of the events
+ * @param point The tile on fire
+ * @param tick The tick from which the tile tries to spread and change state (on the next ticks)
+ */
+void schedule_fire(Grid * grid, EventQueue * queue, Point point, int tick) {
+	int index = point.x * grid->size + point.y;
+	double change = get_state_change_probability(grid->model);
+
+	// A new fire changes state once before burning out on the next change, the fire spreads until it burns out
+	int lifetime = get_geometric(&grid->random, change);
+	if (grid->data[point.x][point.y].state == 0) {
+		push_event(queue, (Event) {.tick = tick + lifetime, .type = EVENT_CHANGE, .index = index});
+		lifetime += get_geometric(&grid->random, change);
+	}
+	push_event(queue, (Event) {.tick = tick + lifetime, .type = EVENT_BURN_OUT, .index = index});
+
+	Point neighbors[8];
+	get_direct_neighbors(grid, point, neighbors);
+	get_diagonal_neighbors(grid, point, neighbors + 4);
+
+	int n_neighbors = grid->model == 1 ? 8 : 4;
+	for (int k = 0; k < n_neighbors; k++) {
+		if (!is_valid(grid, neighbors[k])) {
+			continue;
+		}
+
+		double probability = get_spread_probability(grid, point, neighbors[k]);
+		if (probability <= 0) {
+			continue;
+		}
+
+		int ticks = get_geometric(&grid->random, probability);
+		if (ticks <= lifetime) {
+			push_event(queue, (Event) {
+					.tick = tick + ticks,
+					.type = EVENT_IGNITE,
+					.index = neighbors[k].x * grid->size + neighbors[k].y
+			});
+		}
+	}
+}
+
+/**
+ * Run a grid until it ends with the event-driven engine, statistically equivalent to ticking it
+ * <p>
+ * On every tick, a tile on fire tries to set each neighbor on fire and to change state with fixed probabilities, so
+ * the number of ticks until each success follows a geometric distribution. These numbers are drawn once when the tile
+ * is set on fire, and the ignitions and state changes are processed in time order, so the ticks without event are
+ * skipped. A neighbor is set on fire by the first ignition reaching it. The models other than 0, 1 and 3 are ticked.
+ * The grid is left as after the ticks, except the statistics of the fire front that are not tracked between events.
+ * </p>
+ *
+ * @param grid The grid to run
+ * @param max_ticks The max number of ticks to run (-1 to run until the end)
+ * @return The number of ticks that were run
+ */
+int run_grid_events(Grid * grid, int max_ticks) {
+	if (!is_event_model(grid->model)) {
+		return tick_until_ended(grid, max_ticks);
+	}
+
+	PROFILE_BEGIN(PHASE_TICK);
+
+	// The wind and the tiles may have been changed since the creation of the grid
+	own_tiles(grid);
+	if (grid->n_ticks == 0) {
+		compute_statistics(grid);
+	}
+	if (!grid->spread.ready) {
+		grid->spread = create_spread_table(grid->wind_direction, grid->wind_speed);
+	}
+
+	int start = grid->n_ticks;
+	EventQueue queue = {.events = NULL, .count = 0, .capacity = 0};
+	for (int x = 0; x < grid->size; x++) {
+		for (int y = 0; y < grid->size; y++) {
+			if (grid->data[x][y].current_type == FIRE) {
+				schedule_fire(grid, &queue, (Point) {x, y}, start);
+			}
+		}
+	}
+
+	int last = start;
+	while (queue.count > 0 && (max_ticks < 0 || queue.events[0].tick <= start + max_ticks)) {
+		Event event = pop_event(&queue);
+		Point point = {event.index / grid->size, event.index % grid->size};
+		Tile * tile = &grid->data[point.x][point.y];
+
+		// The ignition tick of a tile is the tick of the event
+		grid->n_ticks = event.tick;
+
+		if (event.type == EVENT_IGNITE) {
+			// A tile is set on fire only by the first ignition reaching it
+			if (tile->current_type == FIRE || tile->current_type == BURNT) {
+				continue;
+			}
+
+			set_tile_type(grid, grid->data, point, FIRE);
+			schedule_fire(grid, &queue, point, event.tick);
+		} else if (event.type == EVENT_CHANGE) {
+			tile->state++;
+		} else {
+			set_tile_type(grid, grid->data, point, BURNT);
+		}
+
+		last = event.tick;
+	}
+	free(queue.events);
+
+	grid->ended = is_ended(*grid);
+	grid->n_ticks = grid->ended || max_ticks < 0 ? last : start + max_ticks;
+	add_live_counter(LIVE_TICKS, grid->n_ticks - start);
+
+	PROFILE_END(PHASE_TICK);
+
+	return grid->n_ticks - start;
+}
@@ -1,9 +1,13 @@
+#pragma once
 #include "draw.c"
+#include "arena.c"
+#include "wind.c"
 #include <cjson/cJSON.h>
 #include <unistd.h>
 #include <png.h>
 #include <sys/stat.h>
 #include <math.h>
+#include <float.h>
 
 /**
  * Model 0 constants
@@ -58,100 +62,116 @@ const double B = 0.46;
 const double C_WIND = 2.93*pow(1.14, -0.5);
 const double C_SLOPE = 5.275*pow(0.08, -0.3);
 
+/**
+ * The size of the blocks of a grid : the blocks without tiles on fire are not updated by the ticks
+ */
+const int BLOCK_SIZE = 64;
+/**
+ * The margin around a block updated with it : the fire spreads to the neighbors of its tiles, and set_tile_type reads
+ * the neighbors of these
+ */
+const int BLOCK_HALO = 2;
+
 
 void write_to_file(Grid grid);
-Tile ** copy_grid(Tile ** data);
-Point * get_direct_neighbors(Grid * grid, Point point);
-Point * get_diagonal_neighbors(Grid * grid, Point point);
-bool is_valid(Point point);
+Tile ** allocate_tiles(int size);
+Tile ** allocate_tiles_in(Arena * arena, int size);
+void free_tiles(Tile ** data);
+Tile ** copy_grid(Tile ** data, int size);
+void swap_tiles(Grid * grid);
+void get_direct_neighbors(Grid * grid, Point point, Point * neighbors);
+void get_diagonal_neighbors(Grid * grid, Point point, Point * neighbors);
+bool is_valid(Grid * grid, Point point);
+void compute_statistics(Grid * grid);
+void count_block_fires(Grid * grid);
+SpreadTable create_spread_table(double wind_direction, double wind_speed);
 void write_png(Grid grid);
 
 /**
- * Create a grid
+ * Fill tiles with a terrain, loaded from grid.json if it exists, otherwise generated randomly
  *
- * @param model The model of the grid
- * @param window The window to draw the grid
- * @param coord_x The x coordinate of the grid
- * @param coord_y The y coordinate of the grid
- * @return The created grid
+ * @param data The tiles to fill
+ * @param scratch Tiles of the same size used while generating the terrain
+ * @param size The size of the terrain
+ * @param random The random number generator used to generate the terrain
+ * @param ignite Whether to set the default tile on fire when the terrain is generated randomly
  */
-Grid create_grid(int model, Window window, int coord_x, int coord_y, bool export_csv, bool export_png) {
-	// Create the grid
+void fill_terrain(Tile ** data, Tile ** scratch, int size, Random * random, bool ignite) {
+	PROFILE_BEGIN(PHASE_TERRAIN);
 	Grid grid = {
-			.data = (Tile **) malloc(GRID_SIZE * sizeof(*grid.data)),
-			.window = window,
-			.model = model,
-			.ended = false,
-			.coord_x = coord_x,
-			.coord_y = coord_y,
-			.export_csv = export_csv,
-			.export_png = export_png,
-			.n_intervals = 0
+			.data = data,
+			.scratch = scratch,
+			.size = size
 	};
 
-	// Initialize the grid
-	for (int i = 0; i < GRID_SIZE; i++) {
-		grid.data[i] = (Tile *) malloc(GRID_SIZE * sizeof(*grid.data[i]));
-	}
-
 	// Load the grid from a json file if it exists, otherwise create a random grid
 	if (access("grid.json", F_OK) == 0) {
 		// The json file exists, we load the grid from it
-		cJSON * grid_json = cJSON_Parse(readfile(fopen("grid.json", "r")));
+		FILE * file = fopen("grid.json", "r");
+		char * content = readfile(file);
+		cJSON * grid_json = cJSON_Parse(content);
 		cJSON * grid_json_object = cJSON_GetObjectItem(grid_json, "grid");
 
-		for (int i = 0; i < GRID_SIZE; i++) {
+		for (int i = 0; i < size; i++) {
 			cJSON * row = cJSON_GetArrayItem(grid_json_object, i);
-			for (int j = 0; j < GRID_SIZE; j++) {
-				// Get the value of the tile and set it to the grid
-				int value = cJSON_GetArrayItem(row, j)->valueint;
-
-				grid.data[i][j].current_type = value;
-				grid.data[i][j].default_type = value;
-				grid.data[i][j].state = 0;
-				grid.data[i][j].altitude = 0;
+			for (int j = 0; j < size; j++) {
+				// Get the value of the tile and set it to the grid (tiles outside of the file are trees)
+				cJSON * cell = cJSON_GetArrayItem(row, j);
+				int value = cell ? cell->valueint : TREE;
+
+				data[i][j].current_type = value;
+				data[i][j].default_type = value;
+				data[i][j].state = 0;
+				data[i][j].ignition_tick = value == FIRE ? 0 : -1;
+				data[i][j].altitude = 0;
 			}
 		}
+
+		cJSON_Delete(grid_json);
+		free(content);
+		if (file) {
+			fclose(file);
+		}
 	} else {
 		// The json file does not exist, we create a random grid
-		for (int i = 0; i < GRID_SIZE; i++) {
-			for (int j = 0; j < GRID_SIZE; j++) {
+		for (int i = 0; i < size; i++) {
+			for (int j = 0; j < size; j++) {
 				// Get a random value between 0 and 3 and set it to the grid
-				int value = get_random(4);
+				int value = get_random(random, 4);
 
-				grid.data[i][j].current_type = value;
-				grid.data[i][j].default_type = value;
-				grid.data[i][j].state = 0;
-				grid.data[i][j].altitude = 0;
+				data[i][j].current_type = value;
+				data[i][j].default_type = value;
+				data[i][j].state = 0;
+				data[i][j].ignition_tick = value == FIRE ? 0 : -1;
+				data[i][j].altitude = 0;
 			}
 		}
 
 		// The automaton iterates over the random grid
 		for (int k = 0; k<6; ++k){
-			//write_png(grid);
-			//++grid.n_intervals;
 			for (int l = 0; l<5; ++l){
 			
-			Tile ** copy = copy_grid(grid.data);
-			for (int i = 0; i < GRID_SIZE; i++) {
-				for (int j = 0; j < GRID_SIZE; j++) {
+			Tile ** copy = grid.scratch;
+			memcpy(copy[0], grid.data[0], size * size * sizeof(**copy));
+			for (int i = 0; i < size; i++) {
+				for (int j = 0; j < size; j++) {
 					Point point = (Point) {i, j};
 					int occ[TILE_TYPE_SIZE] = {0};
 					++occ[grid.data[i][j].current_type];
-					Point* n = get_direct_neighbors(&grid, point);
-					Point* diagn = get_diagonal_neighbors(&grid, point);
+					Point n[4];
+					Point diagn[4];
+					get_direct_neighbors(&grid, point, n);
+					get_diagonal_neighbors(&grid, point, diagn);
 					for (int l = 0; l<4; ++l){
-						if (is_valid(n[l])){
+						if (is_valid(&grid, n[l])){
 							TileType type1 = grid.data[n[l].x][n[l].y].current_type;
 							++occ[type1];
 						}
-						if (is_valid(diagn[l])){
+						if (is_valid(&grid, diagn[l])){
 							TileType type2 = grid.data[diagn[l].x][diagn[l].y].current_type;
 							++occ[type2];
 						}
 					}
-					free(n);
-					free(diagn);
 
 					if (occ[WATER] > occ[GRASS] && occ[WATER] > occ[TREE]){
 						copy[i][j].current_type = WATER;
@@ -166,41 +186,334 @@ Grid create_grid(int model, Window window, int coord_x, int coord_y, bool export
 
 				}
 			}
-			for (int i = 0; i < GRID_SIZE; ++i) {
-				free(grid.data[i]);
-			}
-			free(grid.data);
-			grid.data = copy;
+			swap_tiles(&grid);
 			} 
 		}
 
-		
-		grid.data[GRID_SIZE/6][GRID_SIZE/2].current_type = FIRE;
-		grid.data[GRID_SIZE/6][GRID_SIZE/2].default_type = FIRE;
+		// The result of the automaton may be in the scratch tiles
+		if (grid.data != data) {
+			memcpy(data[0], grid.data[0], (size_t) size * size * sizeof(**data));
+			grid.data = data;
+		}
+
+		if (ignite) {
+			grid.data[size/6][size/2].current_type = FIRE;
+			grid.data[size/6][size/2].default_type = FIRE;
+			grid.data[size/6][size/2].ignition_tick = 0;
+		}
 	}
 
+	PROFILE_END(PHASE_TERRAIN);
+}
+
+/**
+ * Create a terrain, loaded from grid.json if it exists, otherwise generated randomly
+ *
+ * @param size The size of the terrain
+ * @param random The random number generator used to generate the terrain
+ * @param ignite Whether to set the default tile on fire when the terrain is generated randomly
+ * @return The tiles of the terrain, to free with free_tiles
+ */
+Tile ** create_terrain(int size, Random * random, bool ignite) {
+	Tile ** data = allocate_tiles(size);
+	Tile ** scratch = allocate_tiles(size);
+
+	fill_terrain(data, scratch, size, random, ignite);
+	free_tiles(scratch);
+
+	return data;
+}
+
+/**
+ * Get the memory used by the tiles of a grid
+ *
+ * @param size The size of the grid
+ * @return The size in bytes of the tiles and of their rows, once allocated in an arena
+ */
+size_t get_tiles_memory(int size) {
+	return align_size(size * sizeof(Tile *), ARENA_ALIGNMENT) +
+		   align_size((size_t) size * size * sizeof(Tile), ARENA_ALIGNMENT);
+}
+
+/**
+ * Get the number of blocks per side of a grid
+ *
+ * @param size The size of the grid
+ * @return The number of blocks per side
+ */
+int get_n_blocks(int size) {
+	return (size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+}
+
+/**
+ * Create the arena of a grid, holding its current tiles, its scratch buffer and its blocks, an arena released by a
+ * grid of the same thread is reused
+ *
+ * @param size The size of the grid
+ * @return The created arena, to give back with release_arena
+ */
+Arena * create_grid_arena(int size) {
+	size_t n_blocks = (size_t) get_n_blocks(size) * get_n_blocks(size);
+
+	return acquire_arena(2 * get_tiles_memory(size) + 2 * align_size(n_blocks * sizeof(int), ARENA_ALIGNMENT));
+}
+
+/**
+ * Allocate the blocks of a grid in its arena (they are counted by compute_statistics)
+ *
+ * @param grid The grid, without blocks if it has no arena
+ */
+void allocate_blocks(Grid * grid) {
+	if (grid->arena == NULL) {
+		grid->block_fires = NULL;
+		grid->active_blocks = NULL;
+		return;
+	}
+
+	size_t n_blocks = (size_t) get_n_blocks(grid->size) * get_n_blocks(grid->size);
+	grid->block_fires = allocate_in_arena(grid->arena, n_blocks * sizeof(int));
+	grid->active_blocks = allocate_in_arena(grid->arena, n_blocks * sizeof(int));
+}
+
+/**
+ * Create a grid from existing tiles (for example a terrain shared between several grids)
+ *
+ * @param model The model of the grid
+ * @param tiles The tiles to copy into the grid
+ * @param size The size of the grid
+ * @param seed The seed of the random number generator of the grid
+ * @param window The window to draw the grid
+ * @param coord_x The x coordinate of the grid
+ * @param coord_y The y coordinate of the grid
+ * @return The created grid
+ */
+Grid create_grid_from_tiles(int model, Tile ** tiles, int size, uint64_t seed, Window window, int coord_x,
+							int coord_y, bool export_csv, bool export_png) {
+	PROFILE_BEGIN(PHASE_CREATE_GRID);
+	Arena * arena = create_grid_arena(size);
+	Grid grid = {
+			.data = allocate_tiles_in(arena, size),
+			.scratch = allocate_tiles_in(arena, size),
+			.arena = arena,
+			.size = size,
+			.window = window,
+			.model = model,
+			.ended = false,
+			.coord_x = coord_x,
+			.coord_y = coord_y,
+			.export_csv = export_csv,
+			.export_png = export_png,
+			.n_intervals = 0,
+			.n_ticks = 0
+	};
+
+	// The tiles are contiguous, so the copy is a single memcpy
+	memcpy(grid.data[0], tiles[0], (size_t) size * size * sizeof(**tiles));
+	allocate_blocks(&grid);
+	seed_random(&grid.random, seed);
+	compute_statistics(&grid);
+
+	PROFILE_END(PHASE_CREATE_GRID);
+
+	return grid;
+}
+
+/**
+ * Create a grid
+ *
+ * @param model The model of the grid
+ * @param size The size of the grid
+ * @param seed The seed of the random number generator of the grid
+ * @param window The window to draw the grid
+ * @param coord_x The x coordinate of the grid
+ * @param coord_y The y coordinate of the grid
+ * @return The created grid
+ */
+Grid create_grid(int model, int size, uint64_t seed, Window window, int coord_x, int coord_y, bool export_csv,
+				 bool export_png) {
+	PROFILE_BEGIN(PHASE_CREATE_GRID);
+
+	// Create the grid, its tiles are held by its arena
+	Arena * arena = create_grid_arena(size);
+	Grid grid = {
+			.data = allocate_tiles_in(arena, size),
+			.scratch = allocate_tiles_in(arena, size),
+			.arena = arena,
+			.size = size,
+			.window = window,
+			.model = model,
+			.ended = false,
+			.coord_x = coord_x,
+			.coord_y = coord_y,
+			.export_csv = export_csv,
+			.export_png = export_png,
+			.n_intervals = 0,
+			.n_ticks = 0
+	};
+
+	seed_random(&grid.random, seed);
+	fill_terrain(grid.data, grid.scratch, size, &grid.random, true);
+	allocate_blocks(&grid);
+	compute_statistics(&grid);
+
+	PROFILE_END(PHASE_CREATE_GRID);
+
 	return grid;
 };
 
+/**
+ * Allocate the tiles of a grid, all the tiles are stored in a single contiguous block and the rows point into it
+ *
+ * @param size The size of the grid
+ * @return The allocated tiles
+ */
+Tile ** allocate_tiles(int size) {
+	Tile ** data = (Tile **) malloc(size * sizeof(*data));
+	Tile * block = (Tile *) malloc((size_t) size * size * sizeof(*block));
+
+	for (int i = 0; i < size; i++) {
+		data[i] = block + (size_t) i * size;
+	}
+
+	return data;
+}
+
+/**
+ * Allocate the tiles of a grid in an arena, laid out as with allocate_tiles
+ *
+ * @param arena The arena (NULL to allocate them on the heap with allocate_tiles)
+ * @param size The size of the grid
+ * @return The allocated tiles, released with the arena
+ */
+Tile ** allocate_tiles_in(Arena * arena, int size) {
+	if (arena == NULL) {
+		return allocate_tiles(size);
+	}
+
+	Tile ** data = allocate_in_arena(arena, size * sizeof(*data));
+	Tile * block = allocate_in_arena(arena, (size_t) size * size * sizeof(*block));
+
+	for (int i = 0; i < size; i++) {
+		data[i] = block + (size_t) i * size;
+	}
+
+	return data;
+}
+
+/**
+ * Free tiles allocated with allocate_tiles
+ *
+ * @param data The tiles to free
+ */
+void free_tiles(Tile ** data) {
+	if (data == NULL) {
+		return;
+	}
+
+	free(data[0]);
+	free(data);
+}
+
 /**
  * Copy a grid
  *
  * @param data The grid to copy
+ * @param size The size of the grid
  * @return The copied grid
  */
-Tile ** copy_grid(Tile ** data) {
-	// Malloc the copy of the grid
-	Tile ** copy = (Tile **) malloc(GRID_SIZE * sizeof(*copy));
+Tile ** copy_grid(Tile ** data, int size) {
+	Tile ** copy = allocate_tiles(size);
 
-	// Fill the copy with the data of the grid
-	for (int i = 0; i < GRID_SIZE; i++) {
-		copy[i] = (Tile *) malloc(GRID_SIZE * sizeof(*copy[i]));
-		memcpy(copy[i], data[i], GRID_SIZE * sizeof(*copy[i]));
-	}
+	// The tiles are contiguous, so the copy is a single memcpy
+	memcpy(copy[0], data[0], (size_t) size * size * sizeof(**copy));
 
 	return copy;
 }
 
+/**
+ * Swap the data and the scratch buffer of a grid (ie make the computed tick the current one)
+ *
+ * @param grid The grid
+ */
+void swap_tiles(Grid * grid) {
+	Tile ** data = grid->data;
+
+	// Borrowed tiles cannot be reused as the scratch buffer
+	if (grid->shared) {
+		grid->data = grid->scratch;
+		grid->scratch = allocate_tiles_in(grid->arena, grid->size);
+		grid->shared = false;
+		return;
+	}
+
+	grid->data = grid->scratch;
+	grid->scratch = data;
+}
+
+/**
+ * Make a grid own its tiles, copying them if they are borrowed from another grid
+ *
+ * @param grid The grid
+ */
+void own_tiles(Grid * grid) {
+	if (grid->shared) {
+		Tile ** data = allocate_tiles_in(grid->arena, grid->size);
+		memcpy(data[0], grid->data[0], (size_t) grid->size * grid->size * sizeof(**data));
+		grid->data = data;
+		grid->shared = false;
+	}
+}
+
+/**
+ * Fork a grid : the child continues from the current state of the grid with its own random number generator
+ * <p>
+ * The child borrows the tiles of the grid and copies them only when it first modifies them (its first tick or
+ * ignition), so many children can be forked from the same state cheaply. The grid must not be ticked, modified nor
+ * destroyed while its children borrow its tiles.
+ * </p>
+ *
+ * @param grid The grid to fork
+ * @param seed The seed of the random number generator of the child
+ * @return The child, without window nor exports, to destroy with destroy_grid
+ */
+Grid fork_grid(Grid * grid, uint64_t seed) {
+	Grid child = *grid;
+
+	child.scratch = NULL;
+	child.shared = true;
+	child.arena = create_grid_arena(grid->size);
+	child.wind_tables = NULL;
+	child.wind_keyframes = NULL;
+	if (grid->block_fires) {
+		allocate_blocks(&child);
+		size_t n_blocks = (size_t) get_n_blocks(grid->size) * get_n_blocks(grid->size);
+		memcpy(child.block_fires, grid->block_fires, n_blocks * sizeof(int));
+	}
+	child.window = (Window) {.window = NULL, .surface = NULL};
+	child.export_csv = false;
+	child.export_png = false;
+	seed_random(&child.random, seed);
+
+	return child;
+}
+
+/**
+ * Set the wind of a grid, also after its first tick
+ * <p>
+ * The statistics are computed again along the new wind axis, the spread is then measured from the change of wind.
+ * </p>
+ *
+ * @param grid The grid
+ * @param wind_direction The wind direction (0 to 360)
+ * @param wind_speed The wind speed
+ */
+void set_wind(Grid * grid, double wind_direction, double wind_speed) {
+	grid->wind_direction = wind_direction;
+	grid->wind_speed = wind_speed;
+	grid->spread = create_spread_table(wind_direction, wind_speed);
+	compute_statistics(grid);
+}
+
 /**
  * Get the tile at a point
  *
@@ -219,15 +532,11 @@ Tile get_tile(Grid grid, Point point) {
  * @param point The point
  * @return The neighbors of the point
  */
-Point * get_direct_neighbors(Grid * grid, Point point) {
-	Point * neighbors = (Point *) malloc(4 * sizeof(*neighbors));
-
+void get_direct_neighbors(Grid * grid, Point point, Point * neighbors) {
 	neighbors[0] = (Point) {point.x - 1, point.y};
 	neighbors[1] = (Point) {point.x + 1, point.y};
 	neighbors[2] = (Point) {point.x, point.y - 1};
 	neighbors[3] = (Point) {point.x, point.y + 1};
-
-	return neighbors;
 }
 
 /**
@@ -237,114 +546,243 @@ Point * get_direct_neighbors(Grid * grid, Point point) {
  * @param point The point
  * @return The neighbors of the point
  */
-Point * get_diagonal_neighbors(Grid * grid, Point point) {
-	Point * neighbors = (Point *) malloc(4 * sizeof(*neighbors));
-
+void get_diagonal_neighbors(Grid * grid, Point point, Point * neighbors) {
 	neighbors[0] = (Point) {point.x - 1, point.y - 1};
 	neighbors[1] = (Point) {point.x + 1, point.y - 1};
 	neighbors[2] = (Point) {point.x - 1, point.y + 1};
 	neighbors[3] = (Point) {point.x + 1, point.y + 1};
-
-	return neighbors;
 }
 
 /**
  * Check if a point is valid (ie inside the grid)
  *
+ * @param grid The grid
  * @param point The point to check
  * @return True if the point is valid, false otherwise
  */
-bool is_valid(Point point) {
-	return point.x >= 0 && point.x < GRID_SIZE && point.y >= 0 && point.y < GRID_SIZE;
+bool is_valid(Grid * grid, Point point) {
+	return point.x >= 0 && point.x < grid->size && point.y >= 0 && point.y < grid->size;
 }
 
 /**
- * Check if the grid is ended
+ * Check if a tile type can burn
  *
- * @param grid The grid to check
- * @return True if the grid is ended, false otherwise
+ * @param type The type to check
+ * @return True if the type can burn, false otherwise
  */
-bool is_ended(Grid grid) {
-	if (grid.model == 0 || grid.model == 1 || grid.model == 2 || grid.model == 3) {
-		bool is_fire = false;
-
-		// Check if there is no more fire, if there is no more fire, the grid is ended
-		for (int i = 0; i < GRID_SIZE; i++) {
-			for (int j = 0; j < GRID_SIZE; j++) {
-				if (grid.data[i][j].current_type == FIRE) {
-					is_fire = true;
-					break;
-				}
-			}
-		}
+bool is_fuel(TileType type) {
+	return type == TREE || type == GRASS || type == DENSE_TREE;
+}
 
-		return !is_fire;
-	} else {
-		// Unknown model
-		return true;
-	}
+/**
+ * Check if an edge between two tiles is part of the fire front
+ *
+ * @param a The type of the first tile
+ * @param b The type of the second tile
+ * @return 1 if one of the tiles is on fire and the other one can burn, 0 otherwise
+ */
+int is_front_edge(TileType a, TileType b) {
+	return (a == FIRE && is_fuel(b)) || (is_fuel(a) && b == FIRE);
 }
 
 /**
- * Check a probability : if the tile is of the given type and the probability is valid
+ * Get the position of a point along the wind axis
  *
  * @param grid The grid
- * @param point The point to check
- * @param type The type to check
- * @param proba The probability
- * @return True if the probability is valid, false otherwise
+ * @param point The point
+ * @return The position of the point along the wind axis
  */
-bool check_probability(Grid * grid, Point point, TileType type, int proba) {
-	return get_tile(*grid, point).current_type == type && get_random(proba) == 0;
+double project_on_wind(Grid * grid, Point point) {
+	// Same axis as in get_wind
+	return point.x * sin(grid->wind_direction * M_PI / 180.) + point.y * cos(grid->wind_direction * M_PI / 180.);
 }
 
-bool check_probability_3(Grid * grid, Point point, TileType type, double proba) {
-	return get_tile(*grid, point).current_type == type && get_random_3() < proba;
+/**
+ * Add a tile on fire to the bounding box and to the front of the statistics, the first one also setting the origin of
+ * the spread
+ *
+ * @param grid The grid
+ * @param point The point on fire
+ */
+void extend_fire(Grid * grid, Point point) {
+	Statistics * statistics = &grid->statistics;
+
+	statistics->min_x = min(statistics->min_x, point.x);
+	statistics->min_y = min(statistics->min_y, point.y);
+	statistics->max_x = max(statistics->max_x, point.x);
+	statistics->max_y = max(statistics->max_y, point.y);
+
+	double position = project_on_wind(grid, point);
+	if (position > statistics->front) {
+		statistics->front = position;
+	}
+
+	// The spread of a grid that never ticks is measured from its first tile on fire
+	if (statistics->origin == -DBL_MAX) {
+		statistics->origin = position;
+	}
 }
 
 /**
- * Apply the rules to a cell (model 0 and 1)
+ * Compute the statistics of a grid from scratch
  *
  * @param grid The grid
- * @param copy The copy of the grid
- * @param point The point to apply the rules to
- * @param neighbors The neighbors of the point
- * @param tree_burn The probability for a tree tile to burn
- * @param grass_burn The probability for a grass tile to burn
- * @param state_change The probability for a tile to change state between fire and burnt
- */
-void apply_to_cell(Grid * grid, Tile ** copy, Point point, Point * neighbors, int tree_burn, int grass_burn,
-				   int state_change) {
-	// First step, change the state of the neighbors based on the probability
-	for (int k = 0; k < 4; k++) {
-		if (is_valid(neighbors[k])) {
-			if (check_probability(grid, neighbors[k], TREE, tree_burn) ||
-				check_probability(grid, neighbors[k], GRASS, grass_burn)) {
-				Tile * tile_copy = &copy[neighbors[k].x][neighbors[k].y];
+ */
+void compute_statistics(Grid * grid) {
+	Statistics * statistics = &grid->statistics;
+	*statistics = (Statistics) {
+			.burning = 0,
+			.burned = 0,
+			.perimeter = 0,
+			.min_x = grid->size,
+			.min_y = grid->size,
+			.max_x = -1,
+			.max_y = -1,
+			.front = -DBL_MAX,
+			.origin = -DBL_MAX,
+			.rate_of_spread = 0
+	};
 
-				tile_copy->current_type = FIRE;
-				tile_copy->state = 0;
+	for (int i = 0; i < grid->size; i++) {
+		for (int j = 0; j < grid->size; j++) {
+			TileType type = grid->data[i][j].current_type;
+
+			if (type == FIRE) {
+				statistics->burning++;
+				extend_fire(grid, (Point) {i, j});
+			} else if (type == BURNT) {
+				statistics->burned++;
+				extend_fire(grid, (Point) {i, j});
+			}
+
+			// Each edge is counted once, from its top or left tile
+			if (i + 1 < grid->size) {
+				statistics->perimeter += is_front_edge(type, grid->data[i + 1][j].current_type);
+			}
+			if (j + 1 < grid->size) {
+				statistics->perimeter += is_front_edge(type, grid->data[i][j + 1].current_type);
 			}
 		}
 	}
 
-	// Second step, change the state of the point based on the probability to a new state or to burnt
-	Tile point_tile = get_tile(*grid, point);
-	if (check_probability(grid, point, FIRE, state_change)) {
-		Tile * tile_copy = &copy[point.x][point.y];
+	statistics->origin = statistics->front;
+	count_block_fires(grid);
+}
 
-		// If the tile is newly on fire, we increment the state of the tile, otherwise we set it to burnt
-		if (point_tile.state == 0) {
-			tile_copy->state++;
-		} else {
-			tile_copy->current_type = BURNT;
-			tile_copy->state = 0;
+/**
+ * Count the tiles on fire of each block of a grid from scratch
+ *
+ * @param grid The grid (nothing is done if it has no blocks)
+ */
+void count_block_fires(Grid * grid) {
+	if (grid->block_fires == NULL) {
+		return;
+	}
+
+	int n_blocks = get_n_blocks(grid->size);
+	memset(grid->block_fires, 0, (size_t) n_blocks * n_blocks * sizeof(int));
+
+	for (int i = 0; i < grid->size; i++) {
+		for (int j = 0; j < grid->size; j++) {
+			if (grid->data[i][j].current_type == FIRE) {
+				grid->block_fires[(i / BLOCK_SIZE) * n_blocks + j / BLOCK_SIZE]++;
+			}
+		}
+	}
+}
+
+/**
+ * Set the type of a tile (with a state of 0) and update the statistics of the grid
+ *
+ * @param grid The grid
+ * @param tiles The tiles to update (the data of the grid or the copy being computed)
+ * @param point The point of the tile
+ * @param type The new type of the tile
+ */
+void set_tile_type(Grid * grid, Tile ** tiles, Point point, TileType type) {
+	Tile * tile = &tiles[point.x][point.y];
+	TileType previous = tile->current_type;
+
+	tile->state = 0;
+	if (previous == type) {
+		return;
+	}
+
+	Statistics * statistics = &grid->statistics;
+
+	// Update the edges of the fire front around the tile
+	Point neighbors[4] = {
+			{point.x - 1, point.y},
+			{point.x + 1, point.y},
+			{point.x,     point.y - 1},
+			{point.x,     point.y + 1}
+	};
+	for (int k = 0; k < 4; k++) {
+		if (is_valid(grid, neighbors[k])) {
+			TileType neighbor = tiles[neighbors[k].x][neighbors[k].y].current_type;
+			statistics->perimeter += is_front_edge(type, neighbor) - is_front_edge(previous, neighbor);
 		}
 	}
 
-	free(neighbors);
+	if (previous == FIRE) {
+		statistics->burning--;
+	} else if (previous == BURNT) {
+		statistics->burned--;
+	}
+
+	// The blocks are woken up by their first tile on fire and put to sleep by their last one
+	if (grid->block_fires && (previous == FIRE || type == FIRE)) {
+		int block = (point.x / BLOCK_SIZE) * get_n_blocks(grid->size) + point.y / BLOCK_SIZE;
+		grid->block_fires[block] += type == FIRE ? 1 : -1;
+	}
+
+	if (type == FIRE) {
+		statistics->burning++;
+		tile->ignition_tick = grid->n_ticks;
+		extend_fire(grid, point);
+	} else if (type == BURNT) {
+		statistics->burned++;
+	}
+
+	tile->current_type = type;
 }
 
+/**
+ * Set a tile on fire
+ *
+ * @param grid The grid
+ * @param point The point to set on fire
+ * @return True if the tile was set on fire, false if the point is outside the grid
+ */
+bool ignite(Grid * grid, Point point) {
+	if (!is_valid(grid, point)) {
+		return false;
+	}
+
+	own_tiles(grid);
+	set_tile_type(grid, grid->data, point, FIRE);
+	grid->ended = false;
+
+	return true;
+}
+
+/**
+ * Check if the grid is ended
+ *
+ * @param grid The grid to check
+ * @return True if the grid is ended, false otherwise
+ */
+bool is_ended(Grid grid) {
+	PROFILE_COUNT(PHASE_IS_ENDED);
+
+	if (grid.model == 0 || grid.model == 1 || grid.model == 2 || grid.model == 3) {
+		// If there is no more fire, the grid is ended
+		return grid.statistics.burning == 0;
+	} else {
+		// Unknown model
+		return true;
+	}
+}
 
 /**
  * Get the burn probability (used for Alexandridis model)
@@ -425,7 +863,7 @@ double get_burn_probability(Tile tile, Point point, Point parent, Grid * grid) {
  * Get the slope between Point point and point v
  */
 double get_slope(Point point, Point v, Grid* grid){
-	if (!is_valid(v) || !is_valid(point) || v.x == point.x && v.y == point.y) return 0. ;
+	if (!is_valid(grid, v) || !is_valid(grid, point) || v.x == point.x && v.y == point.y) return 0. ;
 	double h = get_tile(*grid, v).altitude - get_tile(*grid, point).altitude;
 	double dx = v.x - point.x;
 	double dy = v.y - point.y;
@@ -436,7 +874,7 @@ double get_slope(Point point, Point v, Grid* grid){
  * Get the projected value of the wind vector onto the vector v-point
  */
 double get_wind(Point point, Point v, Grid* grid){
-	if (!is_valid(v) || !is_valid(point) || v.x == point.x && v.y == point.y) return 0. ;
+	if (!is_valid(grid, v) || !is_valid(grid, point) || v.x == point.x && v.y == point.y) return 0. ;
 	// Wind vector components
 	double Ux = grid->wind_speed*sin(grid->wind_direction*M_PI/180.);
 	double Uy = grid->wind_speed*cos(grid->wind_direction*M_PI/180.);
@@ -447,189 +885,383 @@ double get_wind(Point point, Point v, Grid* grid){
 }
 
 /**
- * Update the grid
+ * Get the probability for a tile to burn from its wind and slope parts (used for Rothermel model)
  *
- * @param grid The grid to update
+ * @param slope The slope between the tile on fire and the tile
+ * @param wind_phi The wind part of phi
+ * @return The burn probability
  */
-void tick(Grid * grid) {
-	Tile ** copy = copy_grid(grid->data);
+double get_rothermel_probability(double slope, double wind_phi) {
+	double phi = signe(slope)*C_SLOPE*slope*slope + wind_phi;
+	if (phi<=-1.){
+		return M3_PROBA_V_BURN*1./(fabs(phi));
+	} else {
+		return 1.-pow(1-M3_PROBA_V_BURN, 1.+phi);
+	}
+}
 
-	// Update the grid based on the model
-	if (grid->model == 0) {
-		// MODEL 0 -> 4 neighbors
-		for (int i = 0; i < GRID_SIZE; i++) {
-			for (int j = 0; j < GRID_SIZE; j++) {
-				Point point = (Point) {i, j};
+/**
+ * Get the index of a direction in a spread table
+ *
+ * @param point The tile on fire
+ * @param neighbor The neighbor of the tile
+ * @return The index of the direction
+ */
+int get_direction(Point point, Point neighbor) {
+	return (neighbor.x - point.x + 1) * 3 + (neighbor.y - point.y + 1);
+}
 
-				// If the tile is not on fire, we continue
-				if (get_tile(*grid, point).current_type != FIRE) {
-					continue;
-				}
+/**
+ * Create the spread table of a wind, it can be shared by all the grids with the same wind
+ *
+ * @param wind_direction The wind direction
+ * @param wind_speed The wind speed
+ * @return The spread table
+ */
+SpreadTable create_spread_table(double wind_direction, double wind_speed) {
+	SpreadTable table = {.ready = true};
 
-				// Apply the rules to the cell
-				apply_to_cell(grid, copy, point, get_direct_neighbors(grid, point), M0_PROBA_TREE_BURN,
-							  M0_PROBA_GRASS_BURN,
-							  M0_PROBA_STATE_CHANGE);
+	// A 3x3 grid holding the wind, whose center is the tile on fire
+	Grid grid = {
+			.size = 3,
+			.wind_direction = wind_direction,
+			.wind_speed = wind_speed
+	};
+	Point center = (Point) {1, 1};
+
+	for (int dx = -1; dx <= 1; dx++) {
+		for (int dy = -1; dy <= 1; dy++) {
+			Point neighbor = (Point) {1 + dx, 1 + dy};
+			int direction = get_direction(center, neighbor);
+
+			for (int type = 0; type < TILE_TYPE_SIZE; type++) {
+				Tile tile = {.current_type = type};
+				table.burn[type][direction] = get_burn_probability(tile, neighbor, center, &grid);
 			}
+
+			double wind = get_wind(center, neighbor, &grid);
+			table.wind_phi[direction] = signe(wind)*C_WIND*pow(fabs(wind), B);
+			table.flat_burn[direction] = get_rothermel_probability(0, table.wind_phi[direction]);
 		}
+	}
 
-		free(grid->data);
+	return table;
+}
+
+/**
+ * The number of models
+ */
+const int N_MODELS = 4;
+
+/**
+ * Get the rules of a model
+ *
+ * @param model The model (0 to N_MODELS - 1)
+ * @return The rules of the model
+ */
+Model get_model(int model) {
+	const Point direct[4] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+	const Point diagonal[4] = {{-1, -1}, {1, -1}, {-1, 1}, {1, 1}};
+	Model rules = {.n_passes = 1};
+	ModelPass * pass = &rules.passes[0];
 
-		grid->data = copy;
+	if (model == 0) {
+		// MODEL 0 -> 4 neighbors
+		*pass = (ModelPass) {.rule = SPREAD_FIXED, .n_neighbors = 4, .state_change = M0_PROBA_STATE_CHANGE};
+		memcpy(pass->neighbors, direct, sizeof(direct));
+		pass->burn[TREE] = M0_PROBA_TREE_BURN;
+		pass->burn[GRASS] = M0_PROBA_GRASS_BURN;
+	} else if (model == 1) {
+		// MODEL 1 -> 8 neighbors (same as model 0 but with diagonal neighbors, each in its own pass)
+		rules.n_passes = 2;
+		*pass = (ModelPass) {.rule = SPREAD_FIXED, .n_neighbors = 4, .state_change = M1_PROBA_STATE_CHANGE};
+		memcpy(pass->neighbors, direct, sizeof(direct));
+		pass->burn[TREE] = M1_C_PROBA_TREE_BURN;
+		pass->burn[GRASS] = M1_C_PROBA_GRASS_BURN;
+
+		pass = &rules.passes[1];
+		*pass = (ModelPass) {.rule = SPREAD_FIXED, .n_neighbors = 4, .state_change = M1_PROBA_STATE_CHANGE};
+		memcpy(pass->neighbors, diagonal, sizeof(diagonal));
+		pass->burn[TREE] = M1_D_PROBA_TREE_BURN;
+		pass->burn[GRASS] = M1_D_PROBA_GRASS_BURN;
+	} else if (model == 2) { // Alexandridis
+		// The new fires spread to the 8 neighbors (a direct one, then a diagonal one) and burn out on the next tick
+		*pass = (ModelPass) {.rule = SPREAD_ALEXANDRIDIS, .n_neighbors = 8, .spread_once = true, .state_change = 1};
+		for (int k = 0; k < 4; k++) {
+			pass->neighbors[2 * k] = direct[k];
+			pass->neighbors[2 * k + 1] = diagonal[k];
+		}
+	} else { // Rothermel
+		*pass = (ModelPass) {
+				.rule = SPREAD_ROTHERMEL,
+				.n_neighbors = 4,
+				.state_change = (int) (1 / M3_PROBA_STATE_CHANGE)
+		};
+		memcpy(pass->neighbors, direct, sizeof(direct));
+		pass->burn[TREE] = 1;
+		pass->burn[GRASS] = 1;
+	}
 
-		draw_grid(grid->window, *grid);
-	} else if (grid->model == 1) {
-		// MODEL 1 -> 8 neighbors (same as model 0 but with diagonal neighbors)
-		for (int i = 0; i < GRID_SIZE; i++) {
-			for (int j = 0; j < GRID_SIZE; j++) {
-				Point point = (Point) {i, j};
+	return rules;
+}
 
-				// If the tile is not on fire, we continue
-				if (get_tile(*grid, point).current_type != FIRE) {
-					continue;
-				}
+/**
+ * Apply a pass of the rules of a model to a tile on fire
+ * <p>
+ * It is inlined into the kernel of each model, so the rules are constants there and their branches are removed.
+ * </p>
+ *
+ * @param grid The grid, its tiles are the current state
+ * @param copy The next state of the tiles
+ * @param point The tile on fire
+ * @param tile The tile on fire in the current state
+ * @param pass The pass
+ */
+static inline __attribute__((always_inline)) void apply_model_pass(Grid * grid, Tile ** copy, Point point, Tile tile,
+																   const ModelPass * pass) {
+	if (pass->spread_once && tile.state != 0) {
+		set_tile_type(grid, copy, point, BURNT);
+		return;
+	}
 
-				// Apply the rules to the cell
-				apply_to_cell(grid, copy, point, get_direct_neighbors(grid, point), M1_C_PROBA_TREE_BURN,
-							  M1_C_PROBA_GRASS_BURN,
-							  M1_PROBA_STATE_CHANGE);
-				apply_to_cell(grid, copy, point, get_diagonal_neighbors(grid, point), M1_D_PROBA_TREE_BURN,
-							  M1_D_PROBA_GRASS_BURN,
-							  M1_PROBA_STATE_CHANGE);
+	const SpreadTable * spread = pass->rule == SPREAD_FIXED ? NULL : get_spread_at(grid, point);
+
+	// First step, spread the fire to the neighbors
+	for (int k = 0; k < pass->n_neighbors; k++) {
+		Point neighbor = {point.x + pass->neighbors[k].x, point.y + pass->neighbors[k].y};
+		if (!is_valid(grid, neighbor)) {
+			continue;
+		}
+
+		TileType type = grid->data[neighbor.x][neighbor.y].current_type;
+		bool burns;
+		if (pass->rule == SPREAD_FIXED) {
+			burns = pass->burn[type] != 0 && get_random(&grid->random, pass->burn[type]) == 0;
+		} else if (pass->rule == SPREAD_ALEXANDRIDIS) {
+			double p_burn = spread->burn[type][get_direction(point, neighbor)];
+			burns = get_random(&grid->random, 1000000) < p_burn * 1000000;
+		} else {
+			if (pass->burn[type] == 0) {
+				continue;
 			}
+
+			double slope = get_slope(point, neighbor, grid);
+			int direction = get_direction(point, neighbor);
+			double proba = slope == 0 ? spread->flat_burn[direction] :
+						   get_rothermel_probability(slope, spread->wind_phi[direction]);
+			burns = get_random_3(&grid->random) < proba;
 		}
 
-		free(grid->data);
+		if (burns) {
+			set_tile_type(grid, copy, neighbor, FIRE);
+		}
+	}
 
-		grid->data = copy;
+	// Second step, change the state of the tile to a new state or to burnt
+	bool change = pass->state_change == 1 ||
+				  (pass->rule == SPREAD_ROTHERMEL ? get_random_3(&grid->random) < 1. / pass->state_change :
+				   get_random(&grid->random, pass->state_change) == 0);
+	if (change) {
+		// If the tile is newly on fire, we increment the state of the tile, otherwise we set it to burnt
+		if (tile.state == 0) {
+			copy[point.x][point.y].state++;
+		} else {
+			set_tile_type(grid, copy, point, BURNT);
+		}
+	}
+}
 
-		draw_grid(grid->window, *grid);
-	} else if (grid->model == 2) { // Alexandridis
-		for (int i = 0; i < GRID_SIZE; i++) {
-			for (int j = 0; j < GRID_SIZE; j++) {
-				Point point = (Point) {i, j};
+/**
+ * Define the kernel of a model : it applies the rules of the model to the tiles on fire of a part of a row, with the
+ * rules known at compile time
+ *
+ * @param number The model
+ */
+#define DEFINE_MODEL_KERNEL(number)                                                                                  \
+	void update_row_model_##number(Grid * grid, Tile ** copy, int i, int first_j, int last_j) {                      \
+		const Model model = get_model(number);                                                                       \
+                                                                                                                     \
+		for (int j = first_j; j < last_j; j++) {                                                                     \
+			Tile tile = grid->data[i][j];                                                                            \
+			if (tile.current_type != FIRE) {                                                                         \
+				continue;                                                                                            \
+			}                                                                                                        \
+                                                                                                                     \
+			for (int p = 0; p < model.n_passes; p++) {                                                               \
+				apply_model_pass(grid, copy, (Point) {i, j}, tile, &model.passes[p]);                                \
+			}                                                                                                        \
+		}                                                                                                            \
+	}
 
-				// If the tile is not on fire, we continue to the next tile
-				Tile tile = get_tile(*grid, point);
-				if (tile.current_type != FIRE) {
-					continue;
-				}
+DEFINE_MODEL_KERNEL(0)
+DEFINE_MODEL_KERNEL(1)
+DEFINE_MODEL_KERNEL(2)
+DEFINE_MODEL_KERNEL(3)
 
-				Tile * copy_tile = &copy[point.x][point.y];
+/**
+ * The kernel of each model
+ */
+void (* const MODEL_KERNELS[])(Grid * grid, Tile ** copy, int i, int first_j, int last_j) = {
+		update_row_model_0,
+		update_row_model_1,
+		update_row_model_2,
+		update_row_model_3
+};
 
-				if (tile.state == 0) {
-					Point * direct_neighbors = get_direct_neighbors(grid, point);
-					Point * diagonal_neighbors = get_diagonal_neighbors(grid, point);
+/**
+ * List the blocks of a grid with tiles on fire into active_blocks, in row-major order
+ *
+ * @param grid The grid, with blocks
+ * @return The number of active blocks
+ */
+int list_active_blocks(Grid * grid) {
+	int n_blocks = get_n_blocks(grid->size);
+	int n_active = 0;
 
-					for (int k = 0; k < 4; k++) {
-						Point direct_point = direct_neighbors[k];
-						if (is_valid(direct_point)) {
-							Tile direct_tile = get_tile(*grid, direct_point);
-							double p_burn = get_burn_probability(direct_tile, direct_point, point, grid);
+	for (int block = 0; block < n_blocks * n_blocks; block++) {
+		if (grid->block_fires[block] > 0) {
+			grid->active_blocks[n_active++] = block;
+		}
+	}
 
-							if (get_random(1000000) < p_burn * 1000000) {
-								Tile * copy_direct_tile = &copy[direct_point.x][direct_point.y];
+	return n_active;
+}
 
-								copy_direct_tile->current_type = FIRE;
-								copy_direct_tile->state = 0;
-							}
-						}
+/**
+ * Copy the active blocks of a grid and their halo from tiles to others
+ *
+ * @param grid The grid
+ * @param from The tiles to copy
+ * @param to The tiles to copy into
+ * @param n_active The number of active blocks
+ */
+void copy_active_blocks(Grid * grid, Tile ** from, Tile ** to, int n_active) {
+	int n_blocks = get_n_blocks(grid->size);
 
-						Point diagonal_point = diagonal_neighbors[k];
-						if (is_valid(diagonal_point)) {
-							Tile diagonal_tile = get_tile(*grid, diagonal_point);
-							double p_burn = get_burn_probability(diagonal_tile, diagonal_point, point, grid);
+	for (int a = 0; a < n_active; a++) {
+		int bx = grid->active_blocks[a] / n_blocks;
+		int by = grid->active_blocks[a] % n_blocks;
+		int first_y = max(0, by * BLOCK_SIZE - BLOCK_HALO);
+		int last_y = min(grid->size, (by + 1) * BLOCK_SIZE + BLOCK_HALO);
 
-							if (get_random(1000000) < p_burn * 1000000) {
-								Tile * copy_diagonal_tile = &copy[diagonal_point.x][diagonal_point.y];
+		for (int i = max(0, bx * BLOCK_SIZE - BLOCK_HALO); i < min(grid->size, (bx + 1) * BLOCK_SIZE + BLOCK_HALO); i++) {
+			memcpy(&to[i][first_y], &from[i][first_y], (size_t) (last_y - first_y) * sizeof(**to));
+		}
+	}
+}
 
-								copy_diagonal_tile->current_type = FIRE;
-								copy_diagonal_tile->state = 0;
-							}
-						}
-					}
+/**
+ * Update the grid
+ * <p>
+ * When few blocks of the grid have tiles on fire, only these blocks and their halo are copied into the scratch buffer
+ * and back, the other blocks sleep. The tiles are visited in the same order in both cases, so the random numbers and
+ * the result are the same.
+ * </p>
+ *
+ * @param grid The grid to update
+ */
+void tick(Grid * grid) {
+	PROFILE_BEGIN(PHASE_TICK);
 
-					free(direct_neighbors);
-					free(diagonal_neighbors);
+	// The wind and the tiles may have been changed since the creation of the grid
+	if (grid->n_ticks == 0) {
+		compute_statistics(grid);
 
-					copy_tile->state = 1;
-				} else {
-					copy_tile->current_type = BURNT;
-					copy_tile->state = 0;
-				}
-			}
+		if (!grid->spread.ready) {
+			grid->spread = create_spread_table(grid->wind_direction, grid->wind_speed);
 		}
+	}
+	grid->n_ticks++;
+	add_live_counter(LIVE_TICKS, 1);
 
-		free(grid->data);
+	// Forked grids allocate their scratch buffer on their first tick
+	if (grid->scratch == NULL) {
+		grid->scratch = allocate_tiles_in(grid->arena, grid->size);
+	}
 
-		grid->data = copy;
+	Tile ** copy = grid->scratch;
+	double front = grid->statistics.front;
+	// The tiles of an unknown model do not change
+	bool known = grid->model >= 0 && grid->model < N_MODELS;
+	void (* kernel)(Grid *, Tile **, int, int, int) = known ? MODEL_KERNELS[grid->model] : NULL;
+	int n_rows = known ? grid->size : 0;
+	int n_blocks = get_n_blocks(grid->size);
+	int n_active = grid->block_fires && !grid->shared ? list_active_blocks(grid) : n_blocks * n_blocks;
+
+	if (2 * n_active < n_blocks * n_blocks) {
+		// The next state of the active blocks is computed into the scratch buffer, then copied back
+		copy_active_blocks(grid, grid->data, copy, n_active);
+
+		int first = 0;
+		for (int i = 0; i < n_rows; i++) {
+			// The active blocks are sorted, so those of the row of i follow the ones of the previous rows
+			while (first < n_active && grid->active_blocks[first] / n_blocks < i / BLOCK_SIZE) {
+				first++;
+			}
 
-		draw_grid(grid->window, *grid);
+			for (int a = first; a < n_active && grid->active_blocks[a] / n_blocks == i / BLOCK_SIZE; a++) {
+				int by = grid->active_blocks[a] % n_blocks;
+				kernel(grid, copy, i, by * BLOCK_SIZE, min(grid->size, (by + 1) * BLOCK_SIZE));
+			}
+		}
 
-	} else if (grid->model == 3) { // Rothermel
-		for (int i = 0; i < GRID_SIZE; i++) {
-			for (int j = 0; j < GRID_SIZE; j++) {
-				Point point = (Point) {i, j};
+		copy_active_blocks(grid, copy, grid->data, n_active);
+	} else {
+		// The next state is computed into the scratch buffer, which starts as a copy of the current state
+		memcpy(copy[0], grid->data[0], (size_t) grid->size * grid->size * sizeof(**copy));
 
-				// If the tile is not on fire, we continue to the next tile
-				Tile tile = get_tile(*grid, point);
-				if (tile.current_type != FIRE) {
-					continue;
-				}
-				Point * neighbors = get_direct_neighbors(grid, point);
-				for (int k = 0; k<4; ++k){
-					if (is_valid(neighbors[k])) {
-						double slope = get_slope(point, neighbors[k], grid);
-						double wind = get_wind(point, neighbors[k], grid);
-						double phi = signe(slope)*C_SLOPE*slope*slope + signe(wind)*C_WIND*pow(fabs(wind), B);
-						double proba;
-						if (phi<=-1.){
-							proba = M3_PROBA_V_BURN*1./(fabs(phi));
-						} else {
-							proba = 1.-pow(1-M3_PROBA_V_BURN, 1.+phi);
-						}
-						//printf("FROM (%d,%d) TO (%d,%d): slope=%.3f wind=%.3f phi=%.3f proba=%.3f\n",point.x, point.y, neighbors[k].x, neighbors[k].y,slope, wind, phi, proba);
+		for (int i = 0; i < n_rows; i++) {
+			kernel(grid, copy, i, 0, grid->size);
+		}
 
-						// change the state of the neighbors based on the probability
-						
-						if (check_probability_3(grid, neighbors[k], TREE, proba) ||
-						check_probability_3(grid, neighbors[k], GRASS, proba)) {
-						
-							Tile * tile_copy = &copy[neighbors[k].x][neighbors[k].y];
+		swap_tiles(grid);
+	}
 
-							tile_copy->current_type = FIRE;
-							tile_copy->state = 0;
-						}
-					}
+	draw_grid(grid->window, *grid);
 
-				}
+	grid->statistics.rate_of_spread = grid->statistics.front - front;
 
-				// change the state of the point based on the probability to a new state or to burnt
-				 
-				if (check_probability_3(grid, point, FIRE, M3_PROBA_STATE_CHANGE)) {
-					Tile * tile_copy = &copy[point.x][point.y];
+	PROFILE_END(PHASE_TICK);
+}
 
-					// If the tile is newly on fire, we increment the state of the tile, otherwise we set it to burnt
-					if (tile.state == 0) {
-						tile_copy->state++;
-					} else {
-						tile_copy->current_type = BURNT;
-						tile_copy->state = 0;
-					}
-				}
+/**
+ * The engine running the grids of run_grid, NULL to tick them (set to run_grid_events by --events)
+ */
+int (* run_grid_engine)(Grid * grid, int max_ticks) = NULL;
 
-				free(neighbors);
+/**
+ * Tick a grid until it ends (without waiting between the ticks)
+ *
+ * @param grid The grid to run
+ * @param max_ticks The max number of ticks to run (-1 to run until the end)
+ * @return The number of ticks that were run
+ */
+int tick_until_ended(Grid * grid, int max_ticks) {
+	int ticks = 0;
+
+	grid->ended = is_ended(*grid);
+	while (!grid->ended && ticks != max_ticks) {
+		tick(grid);
+		grid->ended = is_ended(*grid);
+		ticks++;
+	}
 
-			}
-		}
-		free(grid->data);
-		grid->data = copy;
-		draw_grid(grid->window, *grid);
+	return ticks;
+}
 
-	} else {
-		// Unknown model :(
-		free(copy);
+/**
+ * Run a grid until it ends (without waiting between the ticks), with run_grid_engine if it is set
+ *
+ * @param grid The grid to run
+ * @param max_ticks The max number of ticks to run (-1 to run until the end)
+ * @return The number of ticks that were run
+ */
+int run_grid(Grid * grid, int max_ticks) {
+	if (run_grid_engine) {
+		return run_grid_engine(grid, max_ticks);
 	}
+
+	return tick_until_ended(grid, max_ticks);
 }
 
 /**
@@ -638,6 +1270,7 @@ void tick(Grid * grid) {
  * @param grid The grid to write
  */
 void write_png(Grid grid) {
+	PROFILE_BEGIN(PHASE_EXPORT_PNG);
 	struct stat st = {0};
 	if (stat("grids_png", &st) == -1) {
 		mkdir("grids_png", 0700);
@@ -676,24 +1309,34 @@ void write_png(Grid grid) {
 
 	png_init_io(png, fp);
 
-	// Write the header (8-bit color depth, RGB format)
-	png_set_IHDR(png, info, 512, 512, 8, PNG_COLOR_TYPE_RGB,
+	// Write the header (8-bit color depth, RGB format), each tile is 2x2 pixels
+	int width = 2 * grid.size;
+	png_set_IHDR(png, info, width, width, 8, PNG_COLOR_TYPE_RGB,
 				 PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
 	png_write_info(png, info);
 
-	png_bytep row = (png_bytep) malloc(3 * 512 * sizeof(png_byte));
-
-	Tile tile;
-	Color color;
-	for (int y = 0; y < 512; y++) {
-		for (int x = 0; x < 512; x++) {
-			tile = grid.data[x / TILE_SIZE][y / TILE_SIZE];
-			color = get_color(tile.current_type, tile.state);
-			row[x * 3 + 0] = color.r; // Red
-			row[x * 3 + 1] = color.g;   // Green
-			row[x * 3 + 2] = color.b;   // Blue
+	// The rows of pixels of a band of columns of tiles are filled together, reading the tiles in storage order
+	png_bytep rows = (png_bytep) malloc(2 * BAND_SIZE * 3 * width * sizeof(png_byte));
+	png_bytep band_rows[2 * BAND_SIZE];
+	for (int k = 0; k < 2 * BAND_SIZE; k++) {
+		band_rows[k] = rows + (size_t) k * 3 * width;
+	}
+
+	for (int band = 0; band < grid.size; band += BAND_SIZE) {
+		int band_size = min(BAND_SIZE, grid.size - band);
+
+		for (int x = 0; x < grid.size; x++) {
+			for (int y = 0; y < band_size; y++) {
+				Tile tile = grid.data[x][band + y];
+				Color color = get_color(tile.current_type, tile.state);
+				png_byte pixel[6] = {color.r, color.g, color.b, color.r, color.g, color.b};
+
+				memcpy(band_rows[2 * y] + x * 6, pixel, sizeof(pixel));
+				memcpy(band_rows[2 * y + 1] + x * 6, pixel, sizeof(pixel));
+			}
 		}
-		png_write_row(png, row);
+
+		png_write_rows(png, band_rows, 2 * band_size);
 	}
 
 	// Finish writing the file
@@ -702,9 +1345,11 @@ void write_png(Grid grid) {
 	// Free resources
 	fclose(fp);
 	png_destroy_write_struct(&png, &info);
-	free(row);
+	free(rows);
 
 	free(file_name);
+
+	PROFILE_END(PHASE_EXPORT_PNG);
 }
 
 /**
@@ -713,12 +1358,13 @@ void write_png(Grid grid) {
  * @param grid The grid to write
  */
 void write_csv(Grid grid) {
+	PROFILE_BEGIN(PHASE_EXPORT_CSV);
 	FILE * fp = fopen("grids.csv", "a");
 
 	fprintf(fp, "NEW GRID\n"); // Grid Separator
 
-	for (int x = 0; x < GRID_SIZE; x++) {
-		for (int y = 0; y < GRID_SIZE; ++y) {
+	for (int x = 0; x < grid.size; x++) {
+		for (int y = 0; y < grid.size; ++y) {
 			fprintf(fp, "%d-%d-%d,", grid.data[x][y].current_type, grid.data[x][y].default_type, grid.data[x][y].state);
 		}
 
@@ -726,6 +1372,32 @@ void write_csv(Grid grid) {
 	}
 
 	fclose(fp);
+
+	PROFILE_END(PHASE_EXPORT_CSV);
+}
+
+/**
+ * Write the header of a statistics file
+ *
+ * @param fp The statistics file
+ */
+void write_statistics_header(FILE * fp) {
+	fprintf(fp, "grid,tick,burning,burned,perimeter,min_x,min_y,max_x,max_y,spread,rate_of_spread\n");
+}
+
+/**
+ * Write the current statistics of a grid as a line of a statistics file
+ *
+ * @param fp The statistics file
+ * @param index The index of the grid
+ * @param grid The grid
+ */
+void write_statistics(FILE * fp, int index, Grid grid) {
+	Statistics statistics = grid.statistics;
+
+	fprintf(fp, "%d,%d,%d,%d,%d,%d,%d,%d,%d,%.3f,%.3f\n", index, grid.n_ticks, statistics.burning,
+			statistics.burned, statistics.perimeter, statistics.min_x, statistics.min_y, statistics.max_x,
+			statistics.max_y, statistics.front - statistics.origin, statistics.rate_of_spread);
 }
 
 /**
@@ -742,10 +1414,16 @@ void destroy_grid(Grid grid) {
 		write_csv(grid);
 	}
 
-	// Free the data of the grid
-	for (int i = 0; i < GRID_SIZE; i++) {
-		free(grid.data[i]);
+	free_wind_tables(&grid);
+
+	// The tiles of an arena are released at once, otherwise borrowed tiles belong to another grid
+	if (grid.arena) {
+		release_arena(grid.arena);
+		return;
 	}
 
-	free(grid.data);
+	if (!grid.shared) {
+		free_tiles(grid.data);
+	}
+	free_tiles(grid.scratch);
 }
\ No newline at end of file
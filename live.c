@@ -0,0 +1,175 @@
+#pragma once
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * Live statistics : counters published to a memory-mapped file while the simulations run, read by tipe_top or any
+ * other process mapping the file
+ * <p>
+ * The counters are updated with relaxed atomic operations, without lock, and cost a branch when no file is open.
+ * </p>
+ */
+
+/**
+ * The magic number at the start of a live statistics file
+ */
+const char LIVE_MAGIC[8] = {'T', 'I', 'P', 'E', 'L', 'I', 'V', 'E'};
+/**
+ * The version of the live statistics format
+ */
+const int LIVE_VERSION = 1;
+
+/**
+ * Represents a live counter
+ */
+typedef enum {
+	/**
+	 * The number of ticks run by all the grids (a tick of 64 bit-sliced replicas counts once)
+	 */
+	LIVE_TICKS,
+	/**
+	 * The number of grids of the run
+	 */
+	LIVE_GRIDS,
+	/**
+	 * The number of grids not ended yet
+	 */
+	LIVE_REMAINING,
+	/**
+	 * The number of tiles on fire in the grids of the main loop
+	 */
+	LIVE_BURNING,
+	/**
+	 * The memory mapped by the arenas of the grids and the ensembles, in bytes
+	 */
+	LIVE_MEMORY,
+	/**
+	 * The number of exports being written in the background (checkpoints)
+	 */
+	LIVE_EXPORT_QUEUE,
+	/**
+	 * The number of tasks waiting for a worker in the thread pools
+	 */
+	LIVE_QUEUED_TASKS,
+	/**
+	 * Just to have a size for the enum
+	 */
+	LIVE_COUNTER_COUNT
+} LiveCounter;
+
+/**
+ * The names of the counters, as displayed by tipe_top
+ */
+const char * LIVE_COUNTER_NAMES[LIVE_COUNTER_COUNT] = {"ticks", "grids", "remaining", "burning", "memory",
+													   "export_queue", "queued_tasks"};
+
+/**
+ * Represents the content of a live statistics file
+ */
+typedef struct {
+	/**
+	 * The magic number, written last so a reader never sees a partial header
+	 */
+	char magic[8];
+	/**
+	 * The version of the format
+	 */
+	int version;
+	/**
+	 * The id of the process publishing the statistics
+	 */
+	int pid;
+	/**
+	 * The time the run started, in seconds since the epoch
+	 */
+	int64_t start_time;
+	/**
+	 * Whether the run is finished
+	 */
+	int64_t finished;
+	/**
+	 * The counters, indexed by LiveCounter
+	 */
+	int64_t counters[LIVE_COUNTER_COUNT];
+} LiveStats;
+
+/**
+ * The published statistics, NULL if no file is open (set by --live_stats)
+ */
+LiveStats * live_stats = NULL;
+
+/**
+ * Open a live statistics file and start publishing the counters to it
+ *
+ * @param path The path of the file, replaced if it exists
+ * @return True if the file was opened, false otherwise
+ */
+bool open_live_stats(const char * path) {
+	int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0 || ftruncate(fd, sizeof(LiveStats)) != 0) {
+		fprintf(stderr, "Failed to open file %s for writing\n", path);
+		if (fd >= 0) {
+			close(fd);
+		}
+		return false;
+	}
+
+	void * memory = mmap(NULL, sizeof(LiveStats), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (memory == MAP_FAILED) {
+		fprintf(stderr, "Failed to map file %s\n", path);
+		return false;
+	}
+
+	LiveStats * stats = memory;
+	stats->version = LIVE_VERSION;
+	stats->pid = getpid();
+	stats->start_time = time(NULL);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	memcpy(stats->magic, LIVE_MAGIC, sizeof(LIVE_MAGIC));
+
+	live_stats = stats;
+
+	return true;
+}
+
+/**
+ * Mark the run of the live statistics as finished and stop publishing them
+ */
+void close_live_stats() {
+	if (live_stats) {
+		__atomic_store_n(&live_stats->finished, 1, __ATOMIC_RELEASE);
+		munmap(live_stats, sizeof(LiveStats));
+		live_stats = NULL;
+	}
+}
+
+/**
+ * Add to a live counter (from any thread)
+ *
+ * @param counter The counter
+ * @param delta The value to add
+ */
+static inline void add_live_counter(LiveCounter counter, int64_t delta) {
+	if (live_stats) {
+		__atomic_fetch_add(&live_stats->counters[counter], delta, __ATOMIC_RELAXED);
+	}
+}
+
+/**
+ * Set a live counter (from any thread)
+ *
+ * @param counter The counter
+ * @param value The value
+ */
+static inline void set_live_counter(LiveCounter counter, int64_t value) {
+	if (live_stats) {
+		__atomic_store_n(&live_stats->counters[counter], value, __ATOMIC_RELAXED);
+	}
+}
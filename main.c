@@ -1,5 +1,15 @@
 #include <time.h>
-#include "grid.c"
+#include "server.c"
+#include "probability.c"
+#include "sweep.c"
+#include "branch.c"
+#include "trench.c"
+#include "checkpoint.c"
+#include "arrival.c"
+#include "events.c"
+#include "shard.c"
+#include "store.c"
+#include "estimate.c"
 
 /**
  * Main function of the program
@@ -14,9 +24,64 @@
  * <li>--tick [ms]: The number of milliseconds between each tick</li>
  * <li>--export_csv: Export grids in csv format</li>
  * <li>--export_png: Export grids in png format</li>
+ * <li>--export_stats: Export the statistics of the grids after each tick in stats.csv</li>
  * <li>--wind_direction [direction]: The wind direction (0 to 360)</li>
  * <li>--wind_speed [speed]: The wind speed</li>
- * <li>--generate_mean: Generate the mean of the grids (useful only if you export the grids)</li>
+ * <li>--generate_mean: Generate the mean of the grids (useful only if you export the grids), and write the burn
+ * frequency and mean ignition tick of each tile in ensemble.csv</li>
+ * <li>--seed [seed]: The seed of the random number generators (defaults to the current time)</li>
+ * <li>--serve: Run the job server, reading json jobs from stdin (one per line)</li>
+ * <li>--socket [path]: Run the job server on a unix domain socket</li>
+ * <li>--threads [threads]: The number of worker threads (defaults to the number of processors)</li>
+ * <li>--burn_probability [width]: Estimate the burn probability of each tile, running batches of simulations until
+ * the 95% confidence intervals are narrower than width</li>
+ * <li>--max_runs [runs]: The max number of simulations of --burn_probability (defaults to 10000)</li>
+ * <li>--scalar: Run the simulations of --burn_probability one by one for the models 0 and 1, instead of 64 bit-sliced
+ * replicas at once</li>
+ * <li>--events: Run the simulations of --sweep, --branch, --trench, --burn_probability and of the job server with the
+ * event-driven engine for the models 0, 1 and 3, which skips the ticks without ignition or state change</li>
+ * <li>--sweep: Run every combination of --models, --wind_speeds and --wind_directions and summarize them in
+ * sweep.csv</li>
+ * <li>--models [list]: The models of the sweep, as 0,1,3 or as start:stop:step (defaults to --model)</li>
+ * <li>--wind_speeds [list]: The wind speeds of the sweep (defaults to --wind_speed)</li>
+ * <li>--wind_directions [list]: The wind directions of the sweep (defaults to --wind_direction)</li>
+ * <li>--replicas [replicas]: The number of simulations per point of the sweep (defaults to 10)</li>
+ * <li>--branch [tick]: Run the grid until tick, then fork it into what-if branches for every combination of
+ * --wind_speeds and --wind_directions (--replicas branches each), summarized in branches.csv</li>
+ * <li>--trench [budget]: Search the trench of budget tiles that minimizes the expected burned area from --ignition,
+ * scoring each candidate layout with --replicas runs, and write trench.csv and trench.json</li>
+ * <li>--ignition [x,y]: The point set on fire by --trench and --arrival (defaults to the default fire)</li>
+ * <li>--candidates [candidates]: The number of layouts evaluated by --trench (defaults to 64)</li>
+ * <li>--arrival: Compute the expected arrival time of the fire on every tile from --ignition with the spread
+ * probabilities of --model, without simulating it, and write arrival.csv and arrival.png</li>
+ * <li>--profile: Time the phases of the simulations (grid creation, ticks, drawing, exports, waits) per grid and per
+ * thread, and print a summary at exit</li>
+ * <li>--profile_trace [path]: Also write the timed phases to a Chrome trace event file (implies --profile)</li>
+ * <li>--checkpoint [path]: The checkpoint file, written on SIGUSR1 and every --checkpoint_every ticks (defaults to
+ * checkpoint.bin)</li>
+ * <li>--checkpoint_every [ticks]: The number of ticks between two checkpoints (0 to checkpoint only on SIGUSR1)</li>
+ * <li>--restore [path]: Resume the simulation saved in a checkpoint file, its grids, counters and options replace the
+ * ones of the arguments</li>
+ * <li>--huge_pages: Back the memory of the grids and ensembles with huge pages</li>
+ * <li>--wind_field [path]: A json file of wind rasters changing over time, replacing the uniform wind in the spread of
+ * the models 2 and 3</li>
+ * <li>--shard [index/count]: Run the shard index (from 0) of count shards of the --count replicas, without graphics,
+ * and write their final states and statistics after each tick to shard-[index]-of-[count].bin</li>
+ * <li>--merge [paths...]: Merge the shard files of a run into merged.bin, and into ensemble.csv and time_series.csv
+ * once they cover all its replicas</li>
+ * <li>--estimate [factor]: Estimate quickly where the fire of a --size map goes, simulating it on blocks of factor x
+ * factor tiles (--replicas times), then at full resolution only around the blocks it reached, and write the ignition
+ * tick of the burned tiles to estimate.csv</li>
+ * <li>--size [size]: The size of the map of --estimate (defaults to the size of the grids)</li>
+ * <li>--margin [tiles]: The margin of the full resolution pass of --estimate around the reached blocks (defaults to
+ * 2 blocks)</li>
+ * <li>--live_stats [path]: Publish live counters (grids remaining, ticks, tiles on fire, memory, queues) to a
+ * memory-mapped file, read by tipe_top</li>
+ * <li>--store [path]: Append the metadata and the compressed final state of every grid to the results store in the
+ * directory path</li>
+ * <li>--query [filter]: Write the runs of --store matching a filter like wind_speed>5 (on model, wind_direction,
+ * wind_speed, size, ticks, burned or burning) to query.csv, and their final states to query_grids.csv with
+ * --export_csv</li>
  * <li>--help: Display the help message</li>
  * </ul>
  * </p>
@@ -33,10 +98,44 @@ int main(int argc, char * argv[]) {
 	bool enable_graphics = true;
 	bool export_csv = false;
 	bool export_png = false;
+	bool export_stats = false;
 	double wind_direction = 0;
 	double wind_speed = 0;
 	bool generate_mean = false;
 	int intervals = 1;
+	uint64_t seed = time(NULL);
+	bool serve = false;
+	char * socket_path = NULL;
+	int threads = 0;
+	double burn_probability = 0;
+	int max_runs = 10000;
+	bool scalar = false;
+	bool sweep = false;
+	char * models = NULL;
+	char * wind_speeds = NULL;
+	char * wind_directions = NULL;
+	int replicas = 10;
+	int branch_tick = -1;
+	int trench_budget = 0;
+	Point ignition = {GRID_SIZE / 6, GRID_SIZE / 2};
+	int candidates = 64;
+	bool arrival = false;
+	bool profile = false;
+	char * profile_trace = NULL;
+	char * checkpoint_path = "checkpoint.bin";
+	int checkpoint_every = 0;
+	char * restore_path = NULL;
+	char * wind_field_path = NULL;
+	int shard_index = -1;
+	int n_shards = 0;
+	char ** merge_paths = NULL;
+	int n_merge_paths = 0;
+	char * store_path = NULL;
+	char * live_stats_path = NULL;
+	int estimate_factor = 0;
+	int size = GRID_SIZE;
+	int margin = -1;
+	char * query = NULL;
 
 	if (argc > 1) {
 		for (int i = 1; i < argc; i++) {
@@ -61,13 +160,15 @@ int main(int argc, char * argv[]) {
 					enable_graphics = atoi(argv[i + 1]);
 				}
 			} else if (strcmp(argv[i], "--help") == 0) {
-				printf("Usage: %s --model [model] --count [count] --iterations [iterations] --enable_graphics [0/1] --tick [ms] --export_png --export_csv --wind_direction [direction] --wind_speed [speed] --generate_mean --help\n\nArguments:\n--model [model]: The model of the grid (0-2)\n--count [count]: The number of grids to simulate\n--iterations [iterations]: The max number of iterations\n--enable_graphics [0/1]: Whether graphics are disabled\n--tick [ms]: The number of milliseconds between each tick\n--help: Display this help message\n--export_csv: Export grids in csv format\n--export_png: Export grids in png format\n--wind_direction [direction]: The wind direction (0 to 360)\n--wind_speed [speed]: The wind speed\n--generate_mean: Generate the mean of the grids (useful only if you export the grids)\n--help: Display the help message\n",
+				printf("Usage: %s --model [model] --count [count] --iterations [iterations] --enable_graphics [0/1] --tick [ms] --export_png --export_csv --export_stats --wind_direction [direction] --wind_speed [speed] --generate_mean --seed [seed] --serve --socket [path] --threads [threads] --burn_probability [width] --max_runs [runs] --scalar --events --sweep --models [list] --wind_speeds [list] --wind_directions [list] --replicas [replicas] --branch [tick] --trench [budget] --ignition [x,y] --candidates [candidates] --arrival --profile --profile_trace [path] --checkpoint [path] --checkpoint_every [ticks] --restore [path] --huge_pages --wind_field [path] --shard [index/count] --merge [paths...] --estimate [factor] --size [size] --margin [tiles] --live_stats [path] --store [path] --query [filter] --help\n\nArguments:\n--model [model]: The model of the grid (0-2)\n--count [count]: The number of grids to simulate\n--iterations [iterations]: The max number of iterations\n--enable_graphics [0/1]: Whether graphics are disabled\n--tick [ms]: The number of milliseconds between each tick\n--help: Display this help message\n--export_csv: Export grids in csv format\n--export_png: Export grids in png format\n--export_stats: Export the statistics of the grids after each tick in stats.csv\n--wind_direction [direction]: The wind direction (0 to 360)\n--wind_speed [speed]: The wind speed\n--generate_mean: Generate the mean of the grids (useful only if you export the grids), and write ensemble.csv\n--seed [seed]: The seed of the random number generators\n--serve: Run the job server, reading json jobs from stdin (one per line)\n--socket [path]: Run the job server on a unix domain socket\n--threads [threads]: The number of worker threads\n--burn_probability [width]: Estimate the burn probability of each tile until the 95%% confidence intervals are narrower than width\n--max_runs [runs]: The max number of simulations of --burn_probability\n--scalar: Run the simulations of --burn_probability one by one for the models 0 and 1, instead of 64 bit-sliced replicas at once\n--events: Run the simulations of the batch modes with the event-driven engine for the models 0, 1 and 3\n--sweep: Run every combination of --models, --wind_speeds and --wind_directions and summarize them in sweep.csv\n--models [list]: The models of the sweep, as 0,1,3 or as start:stop:step\n--wind_speeds [list]: The wind speeds of the sweep\n--wind_directions [list]: The wind directions of the sweep\n--replicas [replicas]: The number of simulations per point of the sweep\n--branch [tick]: Run the grid until tick, then fork it into what-if branches for every combination of --wind_speeds and --wind_directions, summarized in branches.csv\n--trench [budget]: Search the trench of budget tiles that minimizes the expected burned area from --ignition\n--ignition [x,y]: The point set on fire by --trench and --arrival\n--candidates [candidates]: The number of layouts evaluated by --trench\n--arrival: Compute the expected arrival time of the fire on every tile without simulating it, and write arrival.csv and arrival.png\n--profile: Time the phases of the simulations per grid and per thread, and print a summary at exit\n--profile_trace [path]: Also write the timed phases to a Chrome trace event file\n--checkpoint [path]: The checkpoint file, written on SIGUSR1 and every --checkpoint_every ticks\n--checkpoint_every [ticks]: The number of ticks between two checkpoints\n--restore [path]: Resume the simulation saved in a checkpoint file\n--huge_pages: Back the memory of the grids and ensembles with huge pages\n--wind_field [path]: A json file of wind rasters changing over time, replacing the uniform wind in the spread of the models 2 and 3\n--shard [index/count]: Run a shard of the --count replicas and write it to shard-[index]-of-[count].bin\n--merge [paths...]: Merge shard files into merged.bin, ensemble.csv and time_series.csv\n--estimate [factor]: Estimate where the fire goes on blocks of factor x factor tiles, then at full resolution around them, and write estimate.csv\n--size [size]: The size of the map of --estimate\n--margin [tiles]: The margin of the full resolution pass of --estimate\n--live_stats [path]: Publish live counters to a memory-mapped file, read by tipe_top\n--store [path]: Append the metadata and the final state of every grid to a results store\n--query [filter]: Write the runs of --store matching a filter like wind_speed>5 to query.csv\n--help: Display the help message\n",
 					   argv[0]);
 				return 0;
 			} else if (strcmp(argv[i], "--export_csv") == 0) {
 				export_csv = true;
 			} else if (strcmp(argv[i], "--export_png") == 0) {
 				export_png = true;
+			} else if (strcmp(argv[i], "--export_stats") == 0) {
+				export_stats = true;
 			} else if (strcmp(argv[i], "--wind_direction") == 0) {
 				if (i + 1 < argc) {
 					wind_direction = atof(argv[i + 1]);
@@ -82,13 +183,237 @@ int main(int argc, char * argv[]) {
 				if (i + 1 < argc) {
 					intervals = atoi(argv[i + 1]);
 				}
+			} else if (strcmp(argv[i], "--seed") == 0) {
+				if (i + 1 < argc) {
+					seed = strtoull(argv[i + 1], NULL, 10);
+				}
+			} else if (strcmp(argv[i], "--serve") == 0) {
+				serve = true;
+			} else if (strcmp(argv[i], "--socket") == 0) {
+				if (i + 1 < argc) {
+					serve = true;
+					socket_path = argv[i + 1];
+				}
+			} else if (strcmp(argv[i], "--threads") == 0) {
+				if (i + 1 < argc) {
+					threads = atoi(argv[i + 1]);
+				}
+			} else if (strcmp(argv[i], "--burn_probability") == 0) {
+				if (i + 1 < argc) {
+					burn_probability = atof(argv[i + 1]);
+				}
+			} else if (strcmp(argv[i], "--max_runs") == 0) {
+				if (i + 1 < argc) {
+					max_runs = atoi(argv[i + 1]);
+				}
+			} else if (strcmp(argv[i], "--scalar") == 0) {
+				scalar = true;
+			} else if (strcmp(argv[i], "--events") == 0) {
+				run_grid_engine = run_grid_events;
+			} else if (strcmp(argv[i], "--sweep") == 0) {
+				sweep = true;
+			} else if (strcmp(argv[i], "--arrival") == 0) {
+				arrival = true;
+			} else if (strcmp(argv[i], "--models") == 0) {
+				if (i + 1 < argc) {
+					models = argv[i + 1];
+				}
+			} else if (strcmp(argv[i], "--wind_speeds") == 0) {
+				if (i + 1 < argc) {
+					wind_speeds = argv[i + 1];
+				}
+			} else if (strcmp(argv[i], "--wind_directions") == 0) {
+				if (i + 1 < argc) {
+					wind_directions = argv[i + 1];
+				}
+			} else if (strcmp(argv[i], "--replicas") == 0) {
+				if (i + 1 < argc) {
+					replicas = atoi(argv[i + 1]);
+				}
+			} else if (strcmp(argv[i], "--branch") == 0) {
+				if (i + 1 < argc) {
+					branch_tick = atoi(argv[i + 1]);
+				}
+			} else if (strcmp(argv[i], "--trench") == 0) {
+				if (i + 1 < argc) {
+					trench_budget = atoi(argv[i + 1]);
+				}
+			} else if (strcmp(argv[i], "--ignition") == 0) {
+				if (i + 1 < argc) {
+					sscanf(argv[i + 1], "%d,%d", &ignition.x, &ignition.y);
+				}
+			} else if (strcmp(argv[i], "--candidates") == 0) {
+				if (i + 1 < argc) {
+					candidates = atoi(argv[i + 1]);
+				}
+			} else if (strcmp(argv[i], "--profile") == 0) {
+				profile = true;
+			} else if (strcmp(argv[i], "--huge_pages") == 0) {
+				use_huge_pages = true;
+			} else if (strcmp(argv[i], "--profile_trace") == 0) {
+				if (i + 1 < argc) {
+					profile = true;
+					profile_trace = argv[i + 1];
+				}
+			} else if (strcmp(argv[i], "--checkpoint") == 0) {
+				if (i + 1 < argc) {
+					checkpoint_path = argv[i + 1];
+				}
+			} else if (strcmp(argv[i], "--checkpoint_every") == 0) {
+				if (i + 1 < argc) {
+					checkpoint_every = atoi(argv[i + 1]);
+				}
+			} else if (strcmp(argv[i], "--restore") == 0) {
+				if (i + 1 < argc) {
+					restore_path = argv[i + 1];
+				}
+			} else if (strcmp(argv[i], "--wind_field") == 0) {
+				if (i + 1 < argc) {
+					wind_field_path = argv[i + 1];
+				}
+			} else if (strcmp(argv[i], "--shard") == 0) {
+				if (i + 1 < argc) {
+					sscanf(argv[i + 1], "%d/%d", &shard_index, &n_shards);
+				}
+			} else if (strcmp(argv[i], "--estimate") == 0) {
+				if (i + 1 < argc) {
+					estimate_factor = atoi(argv[i + 1]);
+				}
+			} else if (strcmp(argv[i], "--size") == 0) {
+				if (i + 1 < argc) {
+					size = atoi(argv[i + 1]);
+				}
+			} else if (strcmp(argv[i], "--margin") == 0) {
+				if (i + 1 < argc) {
+					margin = atoi(argv[i + 1]);
+				}
+			} else if (strcmp(argv[i], "--live_stats") == 0) {
+				if (i + 1 < argc) {
+					live_stats_path = argv[i + 1];
+				}
+			} else if (strcmp(argv[i], "--store") == 0) {
+				if (i + 1 < argc) {
+					store_path = argv[i + 1];
+				}
+			} else if (strcmp(argv[i], "--query") == 0) {
+				if (i + 1 < argc) {
+					query = argv[i + 1];
+				}
+			} else if (strcmp(argv[i], "--merge") == 0) {
+				// The paths are the arguments up to the next option
+				merge_paths = &argv[i + 1];
+				while (i + 1 + n_merge_paths < argc && strncmp(argv[i + 1 + n_merge_paths], "--", 2) != 0) {
+					n_merge_paths++;
+				}
 			}
 		}
 	}
 
-	printf("Launching simulation\nModel %d\nCount %d\nIterations %d\nIntervals %d\nGraphics %d\n", model, count, iterations, intervals, enable_graphics);
+	if (profile) {
+		start_profiler(profile_trace);
+	}
+
+	// The counters are published until the exit, whichever mode returns
+	if (live_stats_path) {
+		if (!open_live_stats(live_stats_path)) {
+			return 1;
+		}
+		atexit(close_live_stats);
+	}
+
+	if (wind_field_path) {
+		wind_field = read_wind_field(wind_field_path);
+		if (!wind_field) {
+			return 1;
+		}
+	}
+
+	if (query) {
+		if (!store_path) {
+			fprintf(stderr, "--query needs --store\n");
+			return 1;
+		}
+		return run_store_query(store_path, query, export_csv);
+	}
+
+	if (merge_paths) {
+		return run_merge(merge_paths, n_merge_paths);
+	}
+
+	if (serve) {
+		// The results are written on stdout when serving stdin, so nothing else is printed
+		return run_server(socket_path, threads, seed);
+	}
 
-	srandom(time(NULL));
+	// The lists default to the single values
+	char model_text[32];
+	char wind_speed_text[32];
+	char wind_direction_text[32];
+	snprintf(model_text, sizeof(model_text), "%d", model);
+	snprintf(wind_speed_text, sizeof(wind_speed_text), "%g", wind_speed);
+	snprintf(wind_direction_text, sizeof(wind_direction_text), "%g", wind_direction);
+
+	if (sweep) {
+		return run_sweep(models ? models : model_text, wind_speeds ? wind_speeds : wind_speed_text,
+						 wind_directions ? wind_directions : wind_direction_text, replicas, iterations, threads, seed);
+	}
+
+	if (branch_tick >= 0) {
+		return run_branches(model, wind_direction, wind_speed, branch_tick, wind_speeds ? wind_speeds : wind_speed_text,
+							wind_directions ? wind_directions : wind_direction_text, replicas, iterations, threads,
+							seed);
+	}
+
+	if (trench_budget > 0) {
+		return run_trench_optimizer(model, wind_direction, wind_speed, trench_budget, ignition, candidates, replicas,
+									iterations, threads, seed);
+	}
+
+	if (arrival) {
+		return run_arrival(model, wind_direction, wind_speed, ignition, seed);
+	}
+
+	if (estimate_factor > 0) {
+		// The default fire of a map is at the same relative position whatever its size
+		if (ignition.x == GRID_SIZE / 6 && ignition.y == GRID_SIZE / 2) {
+			ignition = (Point) {size / 6, size / 2};
+		}
+		return run_estimate(model, wind_direction, wind_speed, size, ignition, estimate_factor,
+							margin >= 0 ? margin : 2 * estimate_factor, replicas, iterations, seed);
+	}
+
+	if (n_shards > 0) {
+		return run_shard(shard_index, n_shards, model, wind_direction, wind_speed, count, iterations, intervals, threads,
+						 seed);
+	}
+
+	if (burn_probability > 0) {
+		return run_burn_probability(model, wind_direction, wind_speed, iterations, burn_probability, max_runs, threads,
+									seed, !scalar);
+	}
+
+	// A restored run takes its grids and its counters from the checkpoint
+	RunState restored;
+	Grid * grids = NULL;
+	Ensemble ensemble;
+	if (restore_path) {
+		if (!load_checkpoint(restore_path, &restored, &grids, &ensemble,
+							 (Window) {.window = NULL, .surface = NULL})) {
+			return 1;
+		}
+
+		count = restored.count;
+		iterations = restored.iterations;
+		intervals = restored.intervals;
+		model = restored.model;
+		wind_direction = restored.wind_direction;
+		wind_speed = restored.wind_speed;
+		generate_mean = restored.generate_mean;
+		seed = restored.seed;
+		printf("Restoring %s\n", restore_path);
+	}
+
+	printf("Launching simulation\nModel %d\nCount %d\nIterations %d\nIntervals %d\nGraphics %d\n", model, count, iterations, intervals, enable_graphics);
 
 	if (tick_ms < 2) {
 		printf("Invalid tick, setting to 2\n");
@@ -100,8 +425,7 @@ int main(int argc, char * argv[]) {
 		count = 1;
 	}
 
-	int remaining = count;
-	Grid * grids = malloc(count * sizeof(*grids));
+	int remaining = restore_path ? restored.remaining : count;
 
 	// Choose the number of grids to display per line and per column
 	int max_x;
@@ -126,8 +450,19 @@ int main(int argc, char * argv[]) {
 		max_y = 7;
 	}
 
-	remove("grids.csv");
-	remove("grids_png");
+	// The exports of a restored run continue the ones of the interrupted run
+	if (!restore_path) {
+		remove("grids.csv");
+		remove("grids_png");
+	}
+
+	FILE * stats_file = NULL;
+	if (export_stats) {
+		stats_file = fopen("stats.csv", restore_path ? "a" : "w");
+		if (!restore_path) {
+			write_statistics_header(stats_file);
+		}
+	}
 
 	// Create the window and the grids
 	Window window;
@@ -140,16 +475,54 @@ int main(int argc, char * argv[]) {
 		};
 	}
 
-	for (int i = 0; i < count; i++) {
-		grids[i] = create_grid(model, window, i % max_x, i / max_x, export_csv, export_png);
-		grids[i].wind_direction = wind_direction;
-		grids[i].wind_speed = wind_speed;
+	if (restore_path) {
+		for (int i = 0; i < count; i++) {
+			grids[i].window = window;
+		}
+	} else {
+		grids = malloc(count * sizeof(*grids));
+		for (int i = 0; i < count; i++) {
+			set_profile_grid(i);
+			grids[i] = create_grid(model, GRID_SIZE, seed + i, window, i % max_x, i / max_x, export_csv, export_png);
+			grids[i].wind_direction = wind_direction;
+			grids[i].wind_speed = wind_speed;
+		}
+		set_profile_grid(-1);
+
+		// The final states are aggregated as soon as each grid ends
+		if (generate_mean) {
+			ensemble = create_ensemble(GRID_SIZE);
+		}
 	}
 
+	set_live_counter(LIVE_GRIDS, count);
+	set_live_counter(LIVE_REMAINING, remaining);
+
+	ResultStore * store = NULL;
+	if (store_path) {
+		store = open_result_store(store_path);
+		if (!store) {
+			return 1;
+		}
+	}
+
+	// A checkpoint can be requested at any time with SIGUSR1
+	signal(SIGUSR1, request_checkpoint);
+	CheckpointWriter * checkpoint_writer = create_checkpoint_writer(checkpoint_path);
+	long n_loop_ticks = 0;
+
 	// Main loop to update the grids and tick until all grids have ended
-	int n_intervals = 0;
+	int n_intervals = restore_path ? restored.n_intervals : 0;
+	bool resuming = restore_path != NULL;
 	do {
 		for (int i = 0; i < count; i++) {
+			// Ended grids without exports were released when they ended, the interval of a restored run was exported
+			// before the checkpoint
+			if (grids[i].data == NULL || resuming) {
+				continue;
+			}
+
+			set_profile_grid(i);
 			if (grids[i].export_png) {
 				write_png(grids[i]);
 			}
@@ -158,17 +531,58 @@ int main(int argc, char * argv[]) {
 				write_csv(grids[i]);
 			}
 		}
-		int iterations_copy = iterations;
+		set_profile_grid(-1);
+		int iterations_copy = resuming ? restored.iterations_left : iterations;
+		resuming = false;
 		do{
+			if (checkpoint_requested || (checkpoint_every > 0 && n_loop_ticks > 0 &&
+										 n_loop_ticks % checkpoint_every == 0)) {
+				RunState state = {
+						.count = count,
+						.iterations = iterations,
+						.intervals = intervals,
+						.n_intervals = n_intervals,
+						.iterations_left = iterations_copy,
+						.remaining = remaining,
+						.model = model,
+						.wind_direction = wind_direction,
+						.wind_speed = wind_speed,
+						.generate_mean = generate_mean,
+						.seed = seed
+				};
+				// A requested checkpoint is retried on the next tick while the previous one is being written
+				if (start_checkpoint(checkpoint_writer, state, grids, &ensemble)) {
+					checkpoint_requested = 0;
+
+					// The index of the store is written with each checkpoint, so a restored run finds the runs
+					// appended before it and does not overwrite them
+					if (store && store->modified) {
+						write_store_index(store);
+					}
+				}
+			}
+
 			SDL_Event event;
 			while (SDL_PollEvent(&event)) {
 				// Used to close the window if the user clicks on the close button
 				if (event.type == SDL_QUIT) {
 					for (int i = 0; i < count; i++) {
-						destroy_grid(grids[i]);
+						if (grids[i].data) {
+							destroy_grid(grids[i]);
+						}
 					}
 
+					if (generate_mean) {
+						destroy_ensemble(ensemble);
+					}
+					if (stats_file) {
+						fclose(stats_file);
+					}
+					if (store) {
+						close_result_store(store);
+					}
 					free(grids);
+					destroy_checkpoint_writer(checkpoint_writer);
 					return 0;
 				}
 				if (event.type == SDL_MOUSEBUTTONDOWN) {
@@ -180,16 +594,44 @@ int main(int argc, char * argv[]) {
 			// Update the grids
 			for (int i = 0; i < count; i++) {
 				if (!grids[i].ended) {
+					set_profile_grid(i);
 					tick(&grids[i]);
 
+					if (stats_file) {
+						write_statistics(stats_file, i, grids[i]);
+					}
+
 					grids[i].ended = is_ended(grids[i]);
-					// If the grid has ended, we decrease the number of remaining grids
+					// If the grid has ended, we decrease the number of remaining grids and release it, unless its final
+					// state is still exported at the next intervals and at the end
 					if (grids[i].ended) {
 						remaining--;
+
+						if (generate_mean) {
+							add_to_ensemble(&ensemble, grids[i]);
+						}
+						if (store) {
+							append_run(store, grids[i], seed + i);
+						}
+						if (!grids[i].export_png && !grids[i].export_csv) {
+							destroy_grid(grids[i]);
+							grids[i].data = NULL;
+							grids[i].scratch = NULL;
+						}
 					}
 				}
 			}
 
+			set_profile_grid(-1);
+			if (live_stats) {
+				int64_t burning = 0;
+				for (int i = 0; i < count; i++) {
+					burning += grids[i].ended ? 0 : grids[i].statistics.burning;
+				}
+				set_live_counter(LIVE_BURNING, burning);
+				set_live_counter(LIVE_REMAINING, remaining);
+			}
+			n_loop_ticks++;
 			wait(tick_ms);
 		} while (--iterations_copy !=-1);
 		wait(2500);
@@ -200,81 +642,47 @@ int main(int argc, char * argv[]) {
 
 	// DO SOMETHING WITH GRIDS IF NEEDED
 	if (generate_mean) {
-		int *** data = malloc(GRID_SIZE * sizeof(*data));
-		for (int i = 0; i < GRID_SIZE; i++) {
-			data[i] = (int **) malloc(GRID_SIZE * sizeof(*data[i]));
-			for (int j = 0; j < GRID_SIZE; j++) {
-				data[i][j] = malloc(TILE_TYPE_SIZE * sizeof(*data[i][j]));
-			}
-		}
-
+		// The grids still running are added with their current state
 		for (int i = 0; i < count; i++) {
-			for (int x = 0; x < GRID_SIZE; x++) {
-				for (int y = 0; y < GRID_SIZE; y++) {
-					data[x][y][grids[i].data[x][y].current_type]++;
-				}
+			if (!grids[i].ended) {
+				add_to_ensemble(&ensemble, grids[i]);
 			}
 		}
 
-		Tile ** tiles = malloc(GRID_SIZE * sizeof(*tiles));
-
-		for (int x = 0; x < GRID_SIZE; x++) {
-			tiles[x] = malloc(GRID_SIZE * sizeof(*tiles[x]));
-			for (int y = 0; y < GRID_SIZE; y++) {
-				tiles[x][y] = (Tile) {
-						.default_type = TILE_TYPE_SIZE,
-						.current_type = TILE_TYPE_SIZE,
-						.state = 0
-				};
-
-				int max = 0;
-				int max_type = 0;
-				for (int i = 0; i < TILE_TYPE_SIZE; i++) {
-					if (data[x][y][i] > max) {
-						max = data[x][y][i];
-						max_type = i;
-					}
-				}
-
-				tiles[x][y].current_type = max_type;
-			}
-		}
-
-		Grid grid = (Grid) {
-				.data = tiles,
-				.window = window,
-				.model = model,
-				.ended = true,
-				.coord_x = -1,
-				.coord_y = -1,
-				.export_png = export_png,
-				.export_csv = export_csv,
-				.wind_direction = wind_direction,
-				.wind_speed = wind_speed
-		};
+		Grid grid = create_mean_grid(ensemble, model, window, export_csv, export_png);
+		grid.wind_direction = wind_direction;
+		grid.wind_speed = wind_speed;
 
 		destroy_grid(grid);
-
-		for (int i = 0; i < GRID_SIZE; i++) {
-			for (int j = 0; j < GRID_SIZE; j++) {
-				free(data[i][j]);
-			}
-			free(data[i]);
-		}
-		free(data);
+		write_ensemble_csv(ensemble, "ensemble.csv");
+		destroy_ensemble(ensemble);
 	}
 
-	
-
-	// Free the memory and close the window
+	// Free the memory and close the window, the grids still running are stored with their current state
 	for (int i = 0; i < count; i++) {
-		destroy_grid(grids[i]);
+		if (!grids[i].ended && store) {
+			append_run(store, grids[i], seed + i);
+		}
+		if (grids[i].data) {
+			set_profile_grid(i);
+			destroy_grid(grids[i]);
+		}
+	}
+	if (store) {
+		close_result_store(store);
 	}
+	set_profile_grid(-1);
 
 	if (enable_graphics) {
 		destroy_window(window);
 	}
+	if (stats_file) {
+		fclose(stats_file);
+	}
 	free(grids);
 
+	// The last checkpoint must be complete before exiting
+	destroy_checkpoint_writer(checkpoint_writer);
+
 	return 0;
 }
@@ -76,19 +76,74 @@ char * readfile(FILE * file) {
 	return buffer;
 }
 
+/**
+ * Rotate a 64 bits integer to the left
+ *
+ * @param x The integer to rotate
+ * @param k The number of bits to rotate
+ * @return The rotated integer
+ */
+static inline uint64_t rotl(uint64_t x, int k) {
+	return (x << k) | (x >> (64 - k));
+}
+
+/**
+ * Seed a random number generator, the state is expanded from the seed with splitmix64
+ *
+ * @param random The random number generator
+ * @param seed The seed
+ */
+void seed_random(Random * random, uint64_t seed) {
+	for (int i = 0; i < 4; i++) {
+		seed += 0x9e3779b97f4a7c15;
+		uint64_t z = seed;
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+		random->s[i] = z ^ (z >> 31);
+	}
+}
+
+/**
+ * Get the next 64 bits random number of a generator
+ * <p>
+ * The numbers are drawn on demand : a step is a few integer operations on a state owned by the caller, without lock,
+ * and generating them ahead into buffers, even with interleaved generators, was measured slower than these steps.
+ * </p>
+ *
+ * @param random The random number generator
+ * @return The random number
+ */
+uint64_t next_random(Random * random) {
+	uint64_t * s = random->s;
+	uint64_t result = rotl(s[1] * 5, 7) * 9;
+	uint64_t t = s[1] << 17;
+
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rotl(s[3], 45);
+
+	return result;
+}
+
 /**
  * Get a random number between 0 and max (excluded)
  *
+ * @param random The random number generator
  * @param max The maximum value
  * @return The random number
  */
-int get_random(int max) {
-	return (int) (random() % max);
+int get_random(Random * random, int max) {
+	return (int) (next_random(random) % max);
 }
 
 /**
  * Get a random number between 0. and 1.
+ *
+ * @param random The random number generator
  */
-double get_random_3() {
-	return (double) rand()/RAND_MAX;
+double get_random_3(Random * random) {
+	return (double) (next_random(random) >> 11) * 0x1.0p-53;
 }
\ No newline at end of file
@@ -0,0 +1,213 @@
+#pragma once
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "live.c"
+
+/**
+ * Represents a task waiting in a thread pool
+ */
+typedef struct Task {
+	/**
+	 * The function to run
+	 */
+	void (* run)(void * argument);
+	/**
+	 * The argument given to the function
+	 */
+	void * argument;
+	/**
+	 * The next task in the queue
+	 */
+	struct Task * next;
+} Task;
+
+/**
+ * Represents a pool of worker threads, kept alive between tasks
+ */
+typedef struct {
+	/**
+	 * The worker threads
+	 */
+	pthread_t * threads;
+	/**
+	 * The number of worker threads
+	 */
+	int n_threads;
+	/**
+	 * The first task of the queue
+	 */
+	Task * head;
+	/**
+	 * The last task of the queue
+	 */
+	Task * tail;
+	/**
+	 * The number of tasks queued or running
+	 */
+	int pending;
+	/**
+	 * Whether the workers must stop
+	 */
+	bool stopping;
+	/**
+	 * The lock protecting the queue
+	 */
+	pthread_mutex_t lock;
+	/**
+	 * Signaled when a task is queued or when the pool is stopping
+	 */
+	pthread_cond_t available;
+	/**
+	 * Signaled when all the tasks are done
+	 */
+	pthread_cond_t done;
+} ThreadPool;
+
+/**
+ * Get the number of online processors
+ *
+ * @return The number of processors (at least 1)
+ */
+int get_processor_count() {
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return count > 0 ? (int) count : 1;
+}
+
+/**
+ * The loop of a worker thread, running tasks until the pool stops
+ *
+ * @param argument The thread pool
+ * @return Nothing
+ */
+void * run_worker(void * argument) {
+	ThreadPool * pool = argument;
+
+	pthread_mutex_lock(&pool->lock);
+	while (true) {
+		while (pool->head == NULL && !pool->stopping) {
+			pthread_cond_wait(&pool->available, &pool->lock);
+		}
+
+		if (pool->head == NULL) {
+			// The pool is stopping and there is nothing left to do
+			break;
+		}
+
+		Task * task = pool->head;
+		pool->head = task->next;
+		add_live_counter(LIVE_QUEUED_TASKS, -1);
+		if (pool->head == NULL) {
+			pool->tail = NULL;
+		}
+
+		pthread_mutex_unlock(&pool->lock);
+		task->run(task->argument);
+		free(task);
+		pthread_mutex_lock(&pool->lock);
+
+		if (--pool->pending == 0) {
+			pthread_cond_broadcast(&pool->done);
+		}
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	return NULL;
+}
+
+/**
+ * Create a thread pool
+ *
+ * @param n_threads The number of worker threads (the number of processors if not positive)
+ * @return The created thread pool
+ */
+ThreadPool * create_thread_pool(int n_threads) {
+	if (n_threads <= 0) {
+		n_threads = get_processor_count();
+	}
+
+	ThreadPool * pool = malloc(sizeof(*pool));
+	*pool = (ThreadPool) {
+			.threads = malloc(n_threads * sizeof(*pool->threads)),
+			.n_threads = n_threads,
+			.head = NULL,
+			.tail = NULL,
+			.pending = 0,
+			.stopping = false
+	};
+
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->available, NULL);
+	pthread_cond_init(&pool->done, NULL);
+
+	for (int i = 0; i < n_threads; i++) {
+		pthread_create(&pool->threads[i], NULL, run_worker, pool);
+	}
+
+	return pool;
+}
+
+/**
+ * Queue a task in a thread pool
+ *
+ * @param pool The thread pool
+ * @param run The function to run
+ * @param argument The argument given to the function
+ */
+void submit_task(ThreadPool * pool, void (* run)(void * argument), void * argument) {
+	Task * task = malloc(sizeof(*task));
+	*task = (Task) {
+			.run = run,
+			.argument = argument,
+			.next = NULL
+	};
+
+	pthread_mutex_lock(&pool->lock);
+	if (pool->tail) {
+		pool->tail->next = task;
+	} else {
+		pool->head = task;
+	}
+	pool->tail = task;
+	pool->pending++;
+	add_live_counter(LIVE_QUEUED_TASKS, 1);
+	pthread_cond_signal(&pool->available);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * Wait until all the tasks of a thread pool are done
+ *
+ * @param pool The thread pool
+ */
+void wait_thread_pool(ThreadPool * pool) {
+	pthread_mutex_lock(&pool->lock);
+	while (pool->pending > 0) {
+		pthread_cond_wait(&pool->done, &pool->lock);
+	}
+	pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * Destroy a thread pool, after running the tasks still queued
+ *
+ * @param pool The thread pool to destroy
+ */
+void destroy_thread_pool(ThreadPool * pool) {
+	pthread_mutex_lock(&pool->lock);
+	pool->stopping = true;
+	pthread_cond_broadcast(&pool->available);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (int i = 0; i < pool->n_threads; i++) {
+		pthread_join(pool->threads[i], NULL);
+	}
+
+	pthread_mutex_destroy(&pool->lock);
+	pthread_cond_destroy(&pool->available);
+	pthread_cond_destroy(&pool->done);
+	free(pool->threads);
+	free(pool);
+}
@@ -0,0 +1,316 @@
+#pragma once
+#include "ensemble.c"
+#include "bitslice.c"
+#include "pool.c"
+
+/**
+ * The z value of the 95% confidence intervals
+ */
+const double PROBABILITY_Z = 1.96;
+
+/**
+ * Represents a share of a batch of simulations, run by a worker into its own partial ensemble
+ */
+typedef struct {
+	/**
+	 * The terrain shared by all the simulations
+	 */
+	Tile ** terrain;
+	/**
+	 * The model of the grids
+	 */
+	int model;
+	/**
+	 * The wind direction
+	 */
+	double wind_direction;
+	/**
+	 * The wind speed
+	 */
+	double wind_speed;
+	/**
+	 * The max number of ticks of a simulation (-1 to run until the end)
+	 */
+	int max_ticks;
+	/**
+	 * The seed of the first simulation, the run r uses seed + r
+	 */
+	uint64_t seed;
+	/**
+	 * The index of the first run of the share
+	 */
+	int first_run;
+	/**
+	 * The number of runs of the share
+	 */
+	int n_runs;
+	/**
+	 * Whether the runs are simulated REPLICAS_PER_WORD at once, the block of runs starting at r uses seed + r
+	 */
+	bool bitsliced;
+	/**
+	 * The partial ensemble of the share
+	 */
+	Ensemble ensemble;
+} BatchShare;
+
+/**
+ * Run the simulations of a share of a batch (run by the workers)
+ *
+ * @param argument The share
+ */
+void run_batch_share(void * argument) {
+	BatchShare * share = argument;
+
+	if (share->bitsliced) {
+		for (int r = share->first_run; r < share->first_run + share->n_runs; r += REPLICAS_PER_WORD) {
+			BitslicedGrid grid = create_bitsliced_grid(share->model, share->terrain, share->ensemble.size,
+													   min(REPLICAS_PER_WORD, share->first_run + share->n_runs - r),
+													   share->seed + r);
+
+			run_bitsliced_grid(&grid, share->max_ticks);
+			add_bitsliced_to_ensemble(&share->ensemble, grid);
+			destroy_bitsliced_grid(grid);
+		}
+
+		return;
+	}
+
+	for (int r = share->first_run; r < share->first_run + share->n_runs; r++) {
+		Grid grid = create_grid_from_tiles(share->model, share->terrain, share->ensemble.size, share->seed + r,
+										   (Window) {.window = NULL, .surface = NULL}, 0, 0, false, false);
+		grid.wind_direction = share->wind_direction;
+		grid.wind_speed = share->wind_speed;
+
+		run_grid(&grid, share->max_ticks);
+		add_to_ensemble(&share->ensemble, grid);
+		destroy_grid(grid);
+	}
+}
+
+/**
+ * Get the width of the 95% confidence interval (Wilson score interval) of a burn probability
+ *
+ * @param burns The number of runs in which the tile burnt
+ * @param runs The number of runs
+ * @return The width of the confidence interval
+ */
+double get_interval_width(int burns, int runs) {
+	double n = runs;
+	double p = burns / n;
+	double z2 = PROBABILITY_Z * PROBABILITY_Z;
+
+	return 2 * PROBABILITY_Z * sqrt(p * (1 - p) / n + z2 / (4 * n * n)) / (1 + z2 / n);
+}
+
+/**
+ * Get the widest confidence interval of the burn probabilities of an ensemble
+ *
+ * @param ensemble The ensemble
+ * @return The width of the widest confidence interval
+ */
+double get_max_interval_width(Ensemble ensemble) {
+	// The width only depends on the number of burns, so it is computed once per distinct count
+	double * widths = malloc((ensemble.count + 1) * sizeof(*widths));
+	for (int burns = 0; burns <= ensemble.count; burns++) {
+		widths[burns] = get_interval_width(burns, ensemble.count);
+	}
+
+	double max_width = 0;
+	size_t n_tiles = (size_t) ensemble.size * ensemble.size;
+	for (size_t i = 0; i < n_tiles; i++) {
+		if (widths[ensemble.burns[i]] > max_width) {
+			max_width = widths[ensemble.burns[i]];
+		}
+	}
+
+	free(widths);
+
+	return max_width;
+}
+
+/**
+ * Write the burn probabilities of an ensemble to a png file (grayscale, white for a probability of 1)
+ *
+ * @param ensemble The ensemble
+ * @param file_name The name of the file
+ */
+void write_probability_png(Ensemble ensemble, const char * file_name) {
+	FILE * fp = fopen(file_name, "wb");
+	if (!fp) {
+		fprintf(stderr, "Failed to open file %s for writing\n", file_name);
+		return;
+	}
+
+	png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	png_infop info = png ? png_create_info_struct(png) : NULL;
+	if (!info) {
+		fprintf(stderr, "Failed to create png structs\n");
+		png_destroy_write_struct(&png, NULL);
+		fclose(fp);
+		return;
+	}
+
+	if (setjmp(png_jmpbuf(png))) { // To handle errors
+		printf("Error during png creation\n");
+		png_destroy_write_struct(&png, &info);
+		fclose(fp);
+		return;
+	}
+
+	png_init_io(png, fp);
+
+	// Same layout as write_png : each tile is 2x2 pixels, x is the column
+	int width = 2 * ensemble.size;
+	png_set_IHDR(png, info, width, width, 8, PNG_COLOR_TYPE_GRAY,
+				 PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+	png_write_info(png, info);
+
+	// Same banding as write_png, the burns are read in storage order
+	png_bytep rows = (png_bytep) malloc(2 * BAND_SIZE * width * sizeof(png_byte));
+	png_bytep band_rows[2 * BAND_SIZE];
+	for (int k = 0; k < 2 * BAND_SIZE; k++) {
+		band_rows[k] = rows + (size_t) k * width;
+	}
+
+	for (int band = 0; band < ensemble.size; band += BAND_SIZE) {
+		int band_size = min(BAND_SIZE, ensemble.size - band);
+
+		for (int x = 0; x < ensemble.size; x++) {
+			for (int y = 0; y < band_size; y++) {
+				int burns = ensemble.burns[(size_t) x * ensemble.size + band + y];
+				png_byte pixel = (png_byte) (255. * burns / ensemble.count + .5);
+
+				band_rows[2 * y][2 * x] = band_rows[2 * y][2 * x + 1] = pixel;
+				band_rows[2 * y + 1][2 * x] = band_rows[2 * y + 1][2 * x + 1] = pixel;
+			}
+		}
+
+		png_write_rows(png, band_rows, 2 * band_size);
+	}
+
+	png_write_end(png, NULL);
+
+	fclose(fp);
+	png_destroy_write_struct(&png, &info);
+	free(rows);
+}
+
+/**
+ * Write the burn probabilities of an ensemble to a binary file : size * size float32 in native byte order, at index
+ * x * size + y
+ *
+ * @param ensemble The ensemble
+ * @param file_name The name of the file
+ */
+void write_probability_binary(Ensemble ensemble, const char * file_name) {
+	FILE * fp = fopen(file_name, "wb");
+	if (!fp) {
+		fprintf(stderr, "Failed to open file %s for writing\n", file_name);
+		return;
+	}
+
+	size_t n_tiles = (size_t) ensemble.size * ensemble.size;
+	float * probabilities = malloc(n_tiles * sizeof(*probabilities));
+	for (size_t i = 0; i < n_tiles; i++) {
+		probabilities[i] = (float) ensemble.burns[i] / ensemble.count;
+	}
+
+	fwrite(probabilities, sizeof(*probabilities), n_tiles, fp);
+
+	free(probabilities);
+	fclose(fp);
+}
+
+/**
+ * Estimate the burn probability of each tile with batches of simulations on the same terrain, until the widest 95%
+ * confidence interval is narrower than the target
+ *
+ * @param model The model of the grids
+ * @param wind_direction The wind direction
+ * @param wind_speed The wind speed
+ * @param max_ticks The max number of ticks of a simulation (-1 to run until the end)
+ * @param target_width The target width of the confidence intervals
+ * @param max_runs The max number of simulations
+ * @param n_threads The number of worker threads (the number of processors if not positive)
+ * @param seed The seed of the terrain and of the simulations
+ * @param bitsliced Whether the simulations of the models 0 and 1 are run REPLICAS_PER_WORD at once
+ * @return The exit code
+ */
+int run_burn_probability(int model, double wind_direction, double wind_speed, int max_ticks, double target_width,
+						 int max_runs, int n_threads, uint64_t seed, bool bitsliced) {
+	Random random;
+	seed_random(&random, seed);
+
+	Tile ** terrain = create_terrain(GRID_SIZE, &random, true);
+	ThreadPool * pool = create_thread_pool(n_threads);
+	Ensemble ensemble = create_ensemble(GRID_SIZE);
+
+	// Each worker runs its share of a batch into its own partial ensemble, merged once the batch is done
+	int n_shares = pool->n_threads;
+	bitsliced = bitsliced && is_bitsliceable(model);
+	int batch_size = bitsliced ? REPLICAS_PER_WORD * n_shares : max(4 * n_shares, 32);
+	BatchShare * shares = malloc(n_shares * sizeof(*shares));
+	for (int i = 0; i < n_shares; i++) {
+		shares[i] = (BatchShare) {
+				.terrain = terrain,
+				.model = model,
+				.wind_direction = wind_direction,
+				.wind_speed = wind_speed,
+				.max_ticks = max_ticks,
+				.seed = seed,
+				.bitsliced = bitsliced,
+				.ensemble = create_ensemble(GRID_SIZE)
+		};
+	}
+
+	double width = 1;
+	set_live_counter(LIVE_GRIDS, max_runs);
+	while (ensemble.count < max_runs && width >= target_width) {
+		set_live_counter(LIVE_REMAINING, max_runs - ensemble.count);
+		int runs = min(batch_size, max_runs - ensemble.count);
+
+		for (int i = 0; i < n_shares; i++) {
+			// The runs are split statically so the result does not depend on the scheduling, bit-sliced runs by blocks
+			// of REPLICAS_PER_WORD so the result does not depend on the number of threads either
+			if (bitsliced) {
+				int n_words = (runs + REPLICAS_PER_WORD - 1) / REPLICAS_PER_WORD;
+				shares[i].first_run = ensemble.count + REPLICAS_PER_WORD * (n_words * i / n_shares);
+				shares[i].n_runs = min(ensemble.count + REPLICAS_PER_WORD * (n_words * (i + 1) / n_shares),
+									   ensemble.count + runs) - shares[i].first_run;
+			} else {
+				shares[i].first_run = ensemble.count + runs * i / n_shares;
+				shares[i].n_runs = ensemble.count + runs * (i + 1) / n_shares - shares[i].first_run;
+			}
+			submit_task(pool, run_batch_share, &shares[i]);
+		}
+		wait_thread_pool(pool);
+
+		for (int i = 0; i < n_shares; i++) {
+			merge_ensemble(&ensemble, shares[i].ensemble);
+			clear_ensemble(&shares[i].ensemble);
+		}
+
+		width = get_max_interval_width(ensemble);
+		printf("Runs %d, widest confidence interval %.4f\n", ensemble.count, width);
+		fflush(stdout);
+	}
+
+	set_live_counter(LIVE_REMAINING, 0);
+	if (width >= target_width) {
+		printf("Stopped after %d runs without reaching the target width %.4f\n", ensemble.count, target_width);
+	}
+
+	write_probability_png(ensemble, "burn_probability.png");
+	write_probability_binary(ensemble, "burn_probability.bin");
+
+	for (int i = 0; i < n_shares; i++) {
+		destroy_ensemble(shares[i].ensemble);
+	}
+	free(shares);
+	destroy_ensemble(ensemble);
+	destroy_thread_pool(pool);
+	free_tiles(terrain);
+
+	return 0;
+}
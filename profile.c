@@ -0,0 +1,415 @@
+#pragma once
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * Phase profiler : timers and counters around the phases of the simulations, per grid and per thread
+ * <p>
+ * The timers cost a branch when the profiler is not started, and nothing when the program is compiled with
+ * -DNO_PROFILE.
+ * </p>
+ */
+
+/**
+ * Represents a phase measured by the profiler
+ */
+typedef enum {
+	/**
+	 * The creation of a grid (including the terrain)
+	 */
+	PHASE_CREATE_GRID,
+	/**
+	 * The generation or the loading of a terrain
+	 */
+	PHASE_TERRAIN,
+	/**
+	 * A tick (including the drawing of the grid)
+	 */
+	PHASE_TICK,
+	/**
+	 * The check of the end of a grid (counted only, it is too fast to be timed)
+	 */
+	PHASE_IS_ENDED,
+	/**
+	 * The drawing of a grid on the window
+	 */
+	PHASE_DRAW,
+	/**
+	 * The export of a grid to a png file
+	 */
+	PHASE_EXPORT_PNG,
+	/**
+	 * The export of a grid to the csv file
+	 */
+	PHASE_EXPORT_CSV,
+	/**
+	 * The waits between the ticks and the intervals
+	 */
+	PHASE_WAIT,
+	/**
+	 * Just to have a size for the enum
+	 */
+	PHASE_COUNT
+} ProfilePhase;
+
+/**
+ * The names of the phases, as displayed in the summary and in the trace
+ */
+const char * PHASE_NAMES[PHASE_COUNT] = {"create_grid", "terrain", "tick", "is_ended", "draw_grid", "write_png",
+										 "write_csv", "wait"};
+
+/**
+ * Represents a timed phase, kept for the trace
+ */
+typedef struct {
+	/**
+	 * The phase
+	 */
+	ProfilePhase phase;
+	/**
+	 * The grid of the phase (-1 if unknown)
+	 */
+	int grid;
+	/**
+	 * The start of the phase in nanoseconds, from the start of the profiler
+	 */
+	double start;
+	/**
+	 * The duration of the phase in nanoseconds
+	 */
+	double duration;
+} ProfileEvent;
+
+/**
+ * Represents the measures of a thread, only written by their thread
+ */
+typedef struct ProfileThread {
+	/**
+	 * The id of the thread, in order of first measure
+	 */
+	int id;
+	/**
+	 * The number of times each phase ran
+	 */
+	long long counts[PHASE_COUNT];
+	/**
+	 * The total time of each phase in nanoseconds
+	 */
+	double totals[PHASE_COUNT];
+	/**
+	 * The longest time of each phase in nanoseconds
+	 */
+	double maxima[PHASE_COUNT];
+	/**
+	 * The total time of each phase per grid, at index grid * PHASE_COUNT + phase
+	 */
+	double * grid_totals;
+	/**
+	 * The number of grids in grid_totals
+	 */
+	int n_grids;
+	/**
+	 * The timed phases (only if the trace is enabled)
+	 */
+	ProfileEvent * events;
+	/**
+	 * The number of timed phases
+	 */
+	size_t n_events;
+	/**
+	 * The capacity of events
+	 */
+	size_t capacity;
+	/**
+	 * The next thread of the list
+	 */
+	struct ProfileThread * next;
+} ProfileThread;
+
+/**
+ * Whether the profiler is started
+ */
+bool profiling = false;
+/**
+ * The path of the trace file (NULL to not write the trace)
+ */
+const char * profile_trace_path = NULL;
+/**
+ * The start of the profiler in nanoseconds
+ */
+double profile_origin = 0;
+/**
+ * The measures of all the threads
+ */
+ProfileThread * profile_threads = NULL;
+/**
+ * The number of threads in profile_threads
+ */
+int n_profile_threads = 0;
+/**
+ * The lock protecting the list of threads
+ */
+pthread_mutex_t profile_lock = PTHREAD_MUTEX_INITIALIZER;
+/**
+ * The measures of the current thread
+ */
+__thread ProfileThread * profile_thread = NULL;
+/**
+ * The grid the current thread works on (-1 if unknown)
+ */
+__thread int profile_grid = -1;
+
+#ifdef NO_PROFILE
+#define PROFILE_BEGIN(phase)
+#define PROFILE_END(phase)
+#define PROFILE_COUNT(phase)
+#else
+/**
+ * Start timing a phase, in the current block
+ */
+#define PROFILE_BEGIN(phase) double profile_start_##phase = profiling ? get_profile_time() : 0
+/**
+ * Stop timing a phase started in the same block
+ */
+#define PROFILE_END(phase) if (profiling) record_profile_phase(phase, profile_start_##phase)
+/**
+ * Count a phase without timing it
+ */
+#define PROFILE_COUNT(phase) if (profiling) count_profile_phase(phase)
+#endif
+
+/**
+ * Get the current time of the profiler
+ *
+ * @return The current time in nanoseconds, from an arbitrary origin
+ */
+double get_profile_time() {
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+
+	return (double) time.tv_sec * 1e9 + (double) time.tv_nsec;
+}
+
+/**
+ * Get the measures of the current thread, registering it on its first measure
+ *
+ * @return The measures of the current thread
+ */
+ProfileThread * get_profile_thread() {
+	if (profile_thread == NULL) {
+		profile_thread = calloc(1, sizeof(*profile_thread));
+
+		pthread_mutex_lock(&profile_lock);
+		profile_thread->id = n_profile_threads++;
+		profile_thread->next = profile_threads;
+		profile_threads = profile_thread;
+		pthread_mutex_unlock(&profile_lock);
+	}
+
+	return profile_thread;
+}
+
+/**
+ * Set the grid the current thread works on, its phases are then attributed to it
+ *
+ * @param grid The index of the grid (-1 if unknown)
+ */
+void set_profile_grid(int grid) {
+	profile_grid = grid;
+}
+
+/**
+ * Count a phase without timing it
+ *
+ * @param phase The phase
+ */
+void count_profile_phase(ProfilePhase phase) {
+	get_profile_thread()->counts[phase]++;
+}
+
+/**
+ * Record a timed phase
+ *
+ * @param phase The phase
+ * @param start The start of the phase, from get_profile_time
+ */
+void record_profile_phase(ProfilePhase phase, double start) {
+	double duration = get_profile_time() - start;
+	ProfileThread * thread = get_profile_thread();
+
+	thread->counts[phase]++;
+	thread->totals[phase] += duration;
+	if (duration > thread->maxima[phase]) {
+		thread->maxima[phase] = duration;
+	}
+
+	if (profile_grid >= 0) {
+		if (profile_grid >= thread->n_grids) {
+			int n_grids = profile_grid + 1 > 2 * thread->n_grids ? profile_grid + 1 : 2 * thread->n_grids;
+			thread->grid_totals = realloc(thread->grid_totals, (size_t) n_grids * PHASE_COUNT * sizeof(double));
+			memset(thread->grid_totals + (size_t) thread->n_grids * PHASE_COUNT, 0,
+				   (size_t) (n_grids - thread->n_grids) * PHASE_COUNT * sizeof(double));
+			thread->n_grids = n_grids;
+		}
+		thread->grid_totals[(size_t) profile_grid * PHASE_COUNT + phase] += duration;
+	}
+
+	if (profile_trace_path) {
+		if (thread->n_events == thread->capacity) {
+			thread->capacity = thread->capacity ? 2 * thread->capacity : 1024;
+			thread->events = realloc(thread->events, thread->capacity * sizeof(*thread->events));
+		}
+		thread->events[thread->n_events++] = (ProfileEvent) {
+				.phase = phase,
+				.grid = profile_grid,
+				.start = start - profile_origin,
+				.duration = duration
+		};
+	}
+}
+
+/**
+ * Print the summary of the profiler on stderr : the phases of all the threads, then the time of each thread and of
+ * each grid
+ */
+void print_profile_summary() {
+	long long counts[PHASE_COUNT] = {0};
+	double totals[PHASE_COUNT] = {0};
+	double maxima[PHASE_COUNT] = {0};
+	int n_grids = 0;
+
+	for (ProfileThread * thread = profile_threads; thread; thread = thread->next) {
+		for (int p = 0; p < PHASE_COUNT; p++) {
+			counts[p] += thread->counts[p];
+			totals[p] += thread->totals[p];
+			if (thread->maxima[p] > maxima[p]) {
+				maxima[p] = thread->maxima[p];
+			}
+		}
+		if (thread->n_grids > n_grids) {
+			n_grids = thread->n_grids;
+		}
+	}
+
+	fprintf(stderr, "\nProfile (%.3f s, %d threads, nested phases are included in their parent)\n",
+			(get_profile_time() - profile_origin) / 1e9, n_profile_threads);
+	fprintf(stderr, "%-12s %12s %12s %12s %12s\n", "phase", "calls", "total ms", "mean us", "max us");
+	for (int p = 0; p < PHASE_COUNT; p++) {
+		if (counts[p] == 0) {
+			continue;
+		}
+
+		if (p == PHASE_IS_ENDED) {
+			fprintf(stderr, "%-12s %12lld %12s %12s %12s\n", PHASE_NAMES[p], counts[p], "-", "-", "-");
+		} else {
+			fprintf(stderr, "%-12s %12lld %12.3f %12.3f %12.3f\n", PHASE_NAMES[p], counts[p], totals[p] / 1e6,
+					totals[p] / counts[p] / 1e3, maxima[p] / 1e3);
+		}
+	}
+
+	fprintf(stderr, "\n%-12s %12s %12s %12s %12s %12s\n", "thread", "create ms", "terrain ms", "tick ms", "export ms",
+			"wait ms");
+	for (ProfileThread * thread = profile_threads; thread; thread = thread->next) {
+		fprintf(stderr, "%-12d %12.3f %12.3f %12.3f %12.3f %12.3f\n", thread->id,
+				thread->totals[PHASE_CREATE_GRID] / 1e6, thread->totals[PHASE_TERRAIN] / 1e6,
+				thread->totals[PHASE_TICK] / 1e6,
+				(thread->totals[PHASE_EXPORT_PNG] + thread->totals[PHASE_EXPORT_CSV]) / 1e6,
+				thread->totals[PHASE_WAIT] / 1e6);
+	}
+
+	if (n_grids > 0) {
+		fprintf(stderr, "\n%-12s %12s %12s %12s %12s\n", "grid", "create ms", "tick ms", "draw ms", "export ms");
+		for (int g = 0; g < n_grids; g++) {
+			double grid_totals[PHASE_COUNT] = {0};
+			for (ProfileThread * thread = profile_threads; thread; thread = thread->next) {
+				for (int p = 0; g < thread->n_grids && p < PHASE_COUNT; p++) {
+					grid_totals[p] += thread->grid_totals[(size_t) g * PHASE_COUNT + p];
+				}
+			}
+
+			// The grids are stored by index, some indexes may not be used
+			if (grid_totals[PHASE_CREATE_GRID] + grid_totals[PHASE_TICK] + grid_totals[PHASE_DRAW] +
+				grid_totals[PHASE_EXPORT_PNG] + grid_totals[PHASE_EXPORT_CSV] == 0) {
+				continue;
+			}
+
+			fprintf(stderr, "%-12d %12.3f %12.3f %12.3f %12.3f\n", g, grid_totals[PHASE_CREATE_GRID] / 1e6,
+					grid_totals[PHASE_TICK] / 1e6, grid_totals[PHASE_DRAW] / 1e6,
+					(grid_totals[PHASE_EXPORT_PNG] + grid_totals[PHASE_EXPORT_CSV]) / 1e6);
+		}
+	}
+}
+
+/**
+ * Write the timed phases to a trace file in the Chrome trace event format (chrome://tracing or Perfetto)
+ *
+ * @param file_name The name of the file
+ */
+void write_profile_trace(const char * file_name) {
+	FILE * fp = fopen(file_name, "w");
+	if (!fp) {
+		fprintf(stderr, "Failed to open file %s for writing\n", file_name);
+		return;
+	}
+
+	fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	bool first = true;
+	for (ProfileThread * thread = profile_threads; thread; thread = thread->next) {
+		fprintf(fp, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s %d\"}}",
+				first ? "" : ",", thread->id, thread->id ? "worker" : "main", thread->id);
+		first = false;
+
+		for (size_t i = 0; i < thread->n_events; i++) {
+			ProfileEvent event = thread->events[i];
+			fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"phase\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,"
+						"\"tid\":%d,\"args\":{\"grid\":%d}}", PHASE_NAMES[event.phase], event.start / 1e3,
+					event.duration / 1e3, thread->id, event.grid);
+		}
+	}
+	fprintf(fp, "\n]}\n");
+
+	fclose(fp);
+}
+
+/**
+ * Stop the profiler : print the summary, write the trace and free the measures (registered with atexit)
+ */
+void stop_profiler() {
+	if (!profiling) {
+		return;
+	}
+	profiling = false;
+
+	print_profile_summary();
+	if (profile_trace_path) {
+		write_profile_trace(profile_trace_path);
+	}
+
+	while (profile_threads) {
+		ProfileThread * next = profile_threads->next;
+		free(profile_threads->grid_totals);
+		free(profile_threads->events);
+		free(profile_threads);
+		profile_threads = next;
+	}
+	profile_thread = NULL;
+}
+
+/**
+ * Start the profiler, its summary is printed at exit
+ *
+ * @param trace_path The path of the trace file (NULL to not write the trace)
+ */
+void start_profiler(const char * trace_path) {
+	profile_trace_path = trace_path;
+	profile_origin = get_profile_time();
+	profiling = true;
+
+	// The main thread is the first one
+	get_profile_thread();
+	atexit(stop_profiler);
+}
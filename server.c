@@ -0,0 +1,283 @@
+#pragma once
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "grid.c"
+#include "pool.c"
+
+/**
+ * Represents an output shared by the jobs of a connection
+ */
+typedef struct {
+	/**
+	 * The file the results are written to
+	 */
+	FILE * file;
+	/**
+	 * The lock protecting the file, as results are written by the workers
+	 */
+	pthread_mutex_t lock;
+} Output;
+
+/**
+ * Represents a job received by the server
+ */
+typedef struct {
+	/**
+	 * The id of the job, written back with its result
+	 */
+	long id;
+	/**
+	 * The model of the grid
+	 */
+	int model;
+	/**
+	 * The wind direction
+	 */
+	double wind_direction;
+	/**
+	 * The wind speed
+	 */
+	double wind_speed;
+	/**
+	 * The seed of the random number generator
+	 */
+	uint64_t seed;
+	/**
+	 * The points set on fire before the first tick
+	 */
+	Point * ignitions;
+	/**
+	 * The number of points set on fire
+	 */
+	int n_ignitions;
+	/**
+	 * The max number of ticks (-1 to run until the end)
+	 */
+	int max_ticks;
+	/**
+	 * The terrain shared by all the jobs
+	 */
+	Tile ** terrain;
+	/**
+	 * The size of the terrain
+	 */
+	int size;
+	/**
+	 * The output the result is written to
+	 */
+	Output * output;
+} Job;
+
+/**
+ * Parse a job from a json line
+ * <p>
+ * The line is an object with the optional keys id, model, wind_direction, wind_speed, seed, max_ticks and
+ * ignitions (an array of [x, y] points, defaults to the default fire of a random terrain)
+ * </p>
+ *
+ * @param line The line to parse
+ * @param job The job to fill
+ * @return True if the line is a valid job, false otherwise
+ */
+bool parse_job(const char * line, Job * job) {
+	cJSON * json = cJSON_Parse(line);
+	if (!cJSON_IsObject(json)) {
+		cJSON_Delete(json);
+		return false;
+	}
+
+	cJSON * item;
+	if (cJSON_IsNumber(item = cJSON_GetObjectItem(json, "id"))) {
+		job->id = (long) item->valuedouble;
+	}
+	if (cJSON_IsNumber(item = cJSON_GetObjectItem(json, "model"))) {
+		job->model = item->valueint;
+	}
+	if (cJSON_IsNumber(item = cJSON_GetObjectItem(json, "wind_direction"))) {
+		job->wind_direction = item->valuedouble;
+	}
+	if (cJSON_IsNumber(item = cJSON_GetObjectItem(json, "wind_speed"))) {
+		job->wind_speed = item->valuedouble;
+	}
+	if (cJSON_IsNumber(item = cJSON_GetObjectItem(json, "seed"))) {
+		job->seed = (uint64_t) item->valuedouble;
+	}
+	if (cJSON_IsNumber(item = cJSON_GetObjectItem(json, "max_ticks"))) {
+		job->max_ticks = item->valueint;
+	}
+
+	cJSON * ignitions = cJSON_GetObjectItem(json, "ignitions");
+	if (cJSON_IsArray(ignitions)) {
+		job->n_ignitions = cJSON_GetArraySize(ignitions);
+		job->ignitions = malloc(max(job->n_ignitions, 1) * sizeof(*job->ignitions));
+
+		for (int i = 0; i < job->n_ignitions; i++) {
+			cJSON * point = cJSON_GetArrayItem(ignitions, i);
+			job->ignitions[i] = (Point) {
+					cJSON_GetArrayItem(point, 0) ? cJSON_GetArrayItem(point, 0)->valueint : -1,
+					cJSON_GetArrayItem(point, 1) ? cJSON_GetArrayItem(point, 1)->valueint : -1
+			};
+		}
+	} else {
+		job->n_ignitions = 1;
+		job->ignitions = malloc(sizeof(*job->ignitions));
+		job->ignitions[0] = (Point) {job->size / 6, job->size / 2};
+	}
+
+	cJSON_Delete(json);
+
+	return true;
+}
+
+/**
+ * Run a job and write its result (run by the workers)
+ *
+ * @param argument The job, freed once done
+ */
+void run_job(void * argument) {
+	Job * job = argument;
+
+	Grid grid = create_grid_from_tiles(job->model, job->terrain, job->size, job->seed,
+									   (Window) {.window = NULL, .surface = NULL}, 0, 0, false, false);
+	grid.wind_direction = job->wind_direction;
+	grid.wind_speed = job->wind_speed;
+
+	for (int i = 0; i < job->n_ignitions; i++) {
+		ignite(&grid, job->ignitions[i]);
+	}
+
+	int ticks = run_grid(&grid, job->max_ticks);
+
+	Statistics statistics = grid.statistics;
+
+	pthread_mutex_lock(&job->output->lock);
+	fprintf(job->output->file,
+			"{\"id\":%ld,\"ticks\":%d,\"burning\":%d,\"burned\":%d,\"perimeter\":%d,\"spread\":%.3f,\"ended\":%s}\n",
+			job->id, ticks, statistics.burning, statistics.burned, statistics.perimeter,
+			statistics.front - statistics.origin, grid.ended ? "true" : "false");
+	fflush(job->output->file);
+	pthread_mutex_unlock(&job->output->lock);
+
+	destroy_grid(grid);
+	free(job->ignitions);
+	free(job);
+}
+
+/**
+ * Serve the jobs of a stream, one json object per line, until the end of the stream
+ *
+ * @param input The stream the jobs are read from
+ * @param output The output the results are written to
+ * @param pool The thread pool running the jobs
+ * @param terrain The terrain shared by all the jobs
+ * @param size The size of the terrain
+ */
+void serve_stream(FILE * input, Output * output, ThreadPool * pool, Tile ** terrain, int size) {
+	char * line = NULL;
+	size_t capacity = 0;
+
+	while (getline(&line, &capacity, input) != -1) {
+		// Skip empty lines
+		if (line[strspn(line, " \t\r\n")] == '\0') {
+			continue;
+		}
+
+		Job * job = malloc(sizeof(*job));
+		*job = (Job) {
+				.id = -1,
+				.model = 0,
+				.wind_direction = 0,
+				.wind_speed = 0,
+				.seed = 0,
+				.ignitions = NULL,
+				.n_ignitions = 0,
+				.max_ticks = -1,
+				.terrain = terrain,
+				.size = size,
+				.output = output
+		};
+
+		if (parse_job(line, job)) {
+			submit_task(pool, run_job, job);
+		} else {
+			pthread_mutex_lock(&output->lock);
+			fprintf(output->file, "{\"error\":\"invalid job\"}\n");
+			fflush(output->file);
+			pthread_mutex_unlock(&output->lock);
+			free(job);
+		}
+	}
+
+	free(line);
+
+	// The output must stay open until all the jobs of the stream are done
+	wait_thread_pool(pool);
+}
+
+/**
+ * Run the job server, the terrain and the worker threads are kept between jobs
+ *
+ * @param socket_path The path of the unix domain socket to listen on, or NULL to serve stdin
+ * @param n_threads The number of worker threads (the number of processors if not positive)
+ * @param seed The seed used to generate the terrain
+ * @return The exit code
+ */
+int run_server(const char * socket_path, int n_threads, uint64_t seed) {
+	Random random;
+	seed_random(&random, seed);
+
+	Tile ** terrain = create_terrain(GRID_SIZE, &random, false);
+	ThreadPool * pool = create_thread_pool(n_threads);
+	int code = 0;
+
+	if (socket_path == NULL) {
+		Output output = {.file = stdout};
+		pthread_mutex_init(&output.lock, NULL);
+
+		serve_stream(stdin, &output, pool, terrain, GRID_SIZE);
+
+		pthread_mutex_destroy(&output.lock);
+	} else {
+		// A client closing its connection early must not kill the server
+		signal(SIGPIPE, SIG_IGN);
+
+		struct sockaddr_un address = {.sun_family = AF_UNIX};
+		strncpy(address.sun_path, socket_path, sizeof(address.sun_path) - 1);
+		unlink(socket_path);
+
+		int server = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (server == -1 || bind(server, (struct sockaddr *) &address, sizeof(address)) == -1 ||
+			listen(server, 16) == -1) {
+			fprintf(stderr, "Failed to listen on %s\n", socket_path);
+			code = 1;
+		} else {
+			printf("Listening on %s\n", socket_path);
+			fflush(stdout);
+
+			// Connections are served one after the other, the jobs of a connection run in parallel
+			int client;
+			while ((client = accept(server, NULL, NULL)) != -1) {
+				FILE * input = fdopen(client, "r");
+				Output output = {.file = fdopen(dup(client), "w")};
+				pthread_mutex_init(&output.lock, NULL);
+
+				serve_stream(input, &output, pool, terrain, GRID_SIZE);
+
+				pthread_mutex_destroy(&output.lock);
+				fclose(output.file);
+				fclose(input);
+			}
+		}
+
+		if (server != -1) {
+			close(server);
+		}
+		unlink(socket_path);
+	}
+
+	destroy_thread_pool(pool);
+	free_tiles(terrain);
+
+	return code;
+}
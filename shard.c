@@ -0,0 +1,503 @@
+#pragma once
+#include "ensemble.c"
+#include "pool.c"
+
+/**
+ * The magic number at the start of a shard file
+ */
+const char SHARD_MAGIC[8] = {'T', 'I', 'P', 'E', 'S', 'H', 'R', 'D'};
+/**
+ * The version of the shard format
+ */
+const int SHARD_VERSION = 3;
+
+/**
+ * Represents the header of a shard file : the options of the whole run and the replicas of the shard
+ * <p>
+ * Shards can only be merged if they share every field except first_run, n_runs and n_ticks.
+ * </p>
+ */
+typedef struct {
+	/**
+	 * The model of the grids
+	 */
+	int model;
+	/**
+	 * The wind direction
+	 */
+	double wind_direction;
+	/**
+	 * The wind speed
+	 */
+	double wind_speed;
+	/**
+	 * The seed of the run, the replica r uses seed + r
+	 */
+	uint64_t seed;
+	/**
+	 * The number of replicas of the whole run
+	 */
+	int count;
+	/**
+	 * The max number of iterations of a replica in one interval, which runs up to max_ticks + 1 ticks like the main
+	 * loop (-1 to run until the end)
+	 */
+	int max_ticks;
+	/**
+	 * The number of intervals of a replica
+	 */
+	int intervals;
+	/**
+	 * The size of the grids
+	 */
+	int size;
+	/**
+	 * The index of the first replica of the shard
+	 */
+	int first_run;
+	/**
+	 * The number of replicas of the shard
+	 */
+	int n_runs;
+	/**
+	 * The number of entries of the time series (the initial state, then one per tick)
+	 */
+	int n_ticks;
+} ShardHeader;
+
+/**
+ * Represents the partial aggregate of a shard : the final states of its replicas and the sums of their statistics
+ * after each tick
+ */
+typedef struct {
+	/**
+	 * The header of the shard
+	 */
+	ShardHeader header;
+	/**
+	 * The final states of the replicas
+	 */
+	Ensemble ensemble;
+	/**
+	 * The sum over the replicas of the number of burning tiles after each tick (n_ticks entries)
+	 */
+	long long * burning;
+	/**
+	 * The sum over the replicas of the number of burned tiles after each tick (n_ticks entries)
+	 */
+	long long * burned;
+	/**
+	 * The capacity of the time series
+	 */
+	int capacity;
+} Shard;
+
+/**
+ * Create an empty shard
+ *
+ * @param header The header of the shard (n_ticks is ignored)
+ * @return The created shard, to destroy with destroy_shard
+ */
+Shard create_shard(ShardHeader header) {
+	header.n_ticks = 0;
+
+	return (Shard) {
+			.header = header,
+			.ensemble = create_ensemble(header.size),
+			.burning = NULL,
+			.burned = NULL,
+			.capacity = 0
+	};
+}
+
+/**
+ * Extend the time series of a shard, an ended replica keeping its final statistics
+ *
+ * @param shard The shard
+ * @param n_ticks The new number of entries (not lower than the current one)
+ */
+void extend_time_series(Shard * shard, int n_ticks) {
+	if (n_ticks > shard->capacity) {
+		shard->capacity = max(n_ticks, 2 * shard->capacity);
+		shard->burning = realloc(shard->burning, shard->capacity * sizeof(*shard->burning));
+		shard->burned = realloc(shard->burned, shard->capacity * sizeof(*shard->burned));
+	}
+
+	int last = shard->header.n_ticks - 1;
+	for (int t = shard->header.n_ticks; t < n_ticks; t++) {
+		shard->burning[t] = last >= 0 ? shard->burning[last] : 0;
+		shard->burned[t] = last >= 0 ? shard->burned[last] : 0;
+	}
+	shard->header.n_ticks = max(shard->header.n_ticks, n_ticks);
+}
+
+/**
+ * Add a time series to the one of a shard, the shorter one padded with its last entry since its replicas ended
+ *
+ * @param shard The shard
+ * @param burning The numbers of burning tiles to add
+ * @param burned The numbers of burned tiles to add
+ * @param n_ticks The number of entries of the series to add
+ */
+void add_time_series(Shard * shard, const long long * burning, const long long * burned, int n_ticks) {
+	extend_time_series(shard, n_ticks);
+	for (int t = 0; n_ticks > 0 && t < shard->header.n_ticks; t++) {
+		shard->burning[t] += burning[min(t, n_ticks - 1)];
+		shard->burned[t] += burned[min(t, n_ticks - 1)];
+	}
+}
+
+/**
+ * Merge a shard into another one : the ensembles are merged and the time series summed
+ *
+ * @param shard The shard to merge into
+ * @param other The shard to merge (of the same run)
+ */
+void merge_shard(Shard * shard, Shard other) {
+	merge_ensemble(&shard->ensemble, other.ensemble);
+	add_time_series(shard, other.burning, other.burned, other.header.n_ticks);
+	shard->header.n_runs += other.header.n_runs;
+}
+
+/**
+ * Destroy a shard
+ *
+ * @param shard The shard to destroy
+ */
+void destroy_shard(Shard shard) {
+	destroy_ensemble(shard.ensemble);
+	free(shard.burning);
+	free(shard.burned);
+}
+
+/**
+ * Run the replicas of a shard, from first_run to first_run + n_runs - 1 (run by the workers)
+ *
+ * @param argument The shard
+ */
+void run_shard_replicas(void * argument) {
+	Shard * shard = argument;
+	ShardHeader header = shard->header;
+
+	int capacity = 64;
+	long long * burning = malloc(capacity * sizeof(*burning));
+	long long * burned = malloc(capacity * sizeof(*burned));
+
+	for (int r = header.first_run; r < header.first_run + header.n_runs; r++) {
+		Grid grid = create_grid(header.model, header.size, header.seed + r, (Window) {.window = NULL, .surface = NULL},
+								0, 0, false, false);
+		grid.wind_direction = header.wind_direction;
+		grid.wind_speed = header.wind_speed;
+
+		// The entry t holds the statistics of the replica after t ticks. As in the main loop, the replica ticks once
+		// before its end is checked, and --iterations N --intervals K runs up to K * (N + 1) ticks
+		int max_ticks = header.max_ticks < 0 ? -1 : header.intervals * (header.max_ticks + 1);
+		int n_ticks = 0;
+		while (true) {
+			if (n_ticks == capacity) {
+				capacity *= 2;
+				burning = realloc(burning, capacity * sizeof(*burning));
+				burned = realloc(burned, capacity * sizeof(*burned));
+			}
+			burning[n_ticks] = grid.statistics.burning;
+			burned[n_ticks] = grid.statistics.burned;
+			n_ticks++;
+
+			if (grid.ended || n_ticks - 1 == max_ticks) {
+				break;
+			}
+
+			tick(&grid);
+			grid.ended = is_ended(grid);
+		}
+
+		add_time_series(shard, burning, burned, n_ticks);
+		add_to_ensemble(&shard->ensemble, grid);
+		destroy_grid(grid);
+		add_live_counter(LIVE_REMAINING, -1);
+	}
+
+	free(burning);
+	free(burned);
+}
+
+/**
+ * Write a shard to a file, through a temporary file renamed once complete so a reader never sees a partial shard
+ *
+ * @param shard The shard to write
+ * @param path The path of the file
+ * @return True if the shard was written, false otherwise
+ */
+bool write_shard(Shard shard, const char * path) {
+	char * temporary_path = malloc(strlen(path) + 5);
+	sprintf(temporary_path, "%s.tmp", path);
+
+	FILE * fp = fopen(temporary_path, "wb");
+	if (!fp) {
+		fprintf(stderr, "Failed to open file %s for writing\n", temporary_path);
+		free(temporary_path);
+		return false;
+	}
+
+	Ensemble ensemble = shard.ensemble;
+	size_t n_tiles = (size_t) ensemble.size * ensemble.size;
+	size_t n_ticks = shard.header.n_ticks;
+
+	bool ok = fwrite(SHARD_MAGIC, sizeof(SHARD_MAGIC), 1, fp) == 1 &&
+			  fwrite(&SHARD_VERSION, sizeof(SHARD_VERSION), 1, fp) == 1 &&
+			  fwrite(&shard.header, sizeof(shard.header), 1, fp) == 1 &&
+			  fwrite(&ensemble.count, sizeof(ensemble.count), 1, fp) == 1 &&
+			  fwrite(ensemble.types, sizeof(*ensemble.types), n_tiles * TILE_TYPE_SIZE, fp) ==
+			  n_tiles * TILE_TYPE_SIZE &&
+			  fwrite(ensemble.burns, sizeof(*ensemble.burns), n_tiles, fp) == n_tiles &&
+			  fwrite(ensemble.ignition_ticks, sizeof(*ensemble.ignition_ticks), n_tiles, fp) == n_tiles &&
+			  fwrite(shard.burning, sizeof(*shard.burning), n_ticks, fp) == n_ticks &&
+			  fwrite(shard.burned, sizeof(*shard.burned), n_ticks, fp) == n_ticks;
+
+	ok = fclose(fp) == 0 && ok && rename(temporary_path, path) == 0;
+	if (!ok) {
+		fprintf(stderr, "Failed to write shard %s\n", path);
+		remove(temporary_path);
+	}
+
+	free(temporary_path);
+
+	return ok;
+}
+
+/**
+ * Read a shard file written by write_shard
+ *
+ * @param path The path of the file
+ * @param shard The read shard, to destroy with destroy_shard
+ * @return True if the shard was read, false otherwise
+ */
+bool read_shard(const char * path, Shard * shard) {
+	FILE * fp = fopen(path, "rb");
+	if (!fp) {
+		fprintf(stderr, "Failed to open file %s for reading\n", path);
+		return false;
+	}
+
+	char magic[sizeof(SHARD_MAGIC)];
+	int version;
+	ShardHeader header;
+	bool ok = fread(magic, sizeof(magic), 1, fp) == 1 && memcmp(magic, SHARD_MAGIC, sizeof(magic)) == 0 &&
+			  fread(&version, sizeof(version), 1, fp) == 1 && version == SHARD_VERSION &&
+			  fread(&header, sizeof(header), 1, fp) == 1 && header.size > 0 && header.n_ticks >= 0;
+
+	if (ok) {
+		*shard = create_shard(header);
+		extend_time_series(shard, header.n_ticks);
+
+		Ensemble * ensemble = &shard->ensemble;
+		size_t n_tiles = (size_t) ensemble->size * ensemble->size;
+		size_t n_ticks = header.n_ticks;
+
+		ok = fread(&ensemble->count, sizeof(ensemble->count), 1, fp) == 1 &&
+			 fread(ensemble->types, sizeof(*ensemble->types), n_tiles * TILE_TYPE_SIZE, fp) ==
+			 n_tiles * TILE_TYPE_SIZE &&
+			 fread(ensemble->burns, sizeof(*ensemble->burns), n_tiles, fp) == n_tiles &&
+			 fread(ensemble->ignition_ticks, sizeof(*ensemble->ignition_ticks), n_tiles, fp) == n_tiles &&
+			 fread(shard->burning, sizeof(*shard->burning), n_ticks, fp) == n_ticks &&
+			 fread(shard->burned, sizeof(*shard->burned), n_ticks, fp) == n_ticks;
+
+		if (!ok) {
+			destroy_shard(*shard);
+		}
+	}
+
+	fclose(fp);
+
+	if (!ok) {
+		fprintf(stderr, "Invalid shard %s\n", path);
+	}
+
+	return ok;
+}
+
+/**
+ * Write the mean time series of a shard to a csv file : for each tick the mean number of burning and burned tiles
+ *
+ * @param shard The shard
+ * @param file_name The name of the file
+ */
+void write_time_series_csv(Shard shard, const char * file_name) {
+	FILE * fp = fopen(file_name, "w");
+	if (!fp) {
+		fprintf(stderr, "Failed to open file %s for writing\n", file_name);
+		return;
+	}
+
+	fprintf(fp, "tick,mean_burning,mean_burned\n");
+
+	for (int t = 0; t < shard.header.n_ticks; t++) {
+		fprintf(fp, "%d,%.4f,%.4f\n", t, (double) shard.burning[t] / shard.header.n_runs,
+				(double) shard.burned[t] / shard.header.n_runs);
+	}
+
+	fclose(fp);
+}
+
+/**
+ * Run a shard of an ensemble : the replicas from count * index / n_shards to count * (index + 1) / n_shards - 1, so
+ * the shards of a run share no replica and cover all of them, whatever the machine running them
+ * <p>
+ * The partial aggregate is written to shard-[index]-of-[n_shards].bin, to combine with run_merge.
+ * </p>
+ *
+ * @param index The index of the shard
+ * @param n_shards The number of shards of the run
+ * @param model The model of the grids
+ * @param wind_direction The wind direction
+ * @param wind_speed The wind speed
+ * @param count The number of replicas of the whole run
+ * @param max_ticks The max number of iterations of a replica in one interval, as --iterations (-1 to run until the
+ * end)
+ * @param intervals The number of intervals of a replica, as --intervals
+ * @param n_threads The number of worker threads (the number of processors if not positive)
+ * @param seed The seed of the run
+ * @return The exit code
+ */
+int run_shard(int index, int n_shards, int model, double wind_direction, double wind_speed, int count, int max_ticks,
+			  int intervals, int n_threads, uint64_t seed) {
+	if (n_shards <= 0 || index < 0 || index >= n_shards || count <= 0) {
+		fprintf(stderr, "Invalid shard %d/%d of %d replicas\n", index, n_shards, count);
+		return 1;
+	}
+
+	ShardHeader header = {
+			.model = model,
+			.wind_direction = wind_direction,
+			.wind_speed = wind_speed,
+			.seed = seed,
+			.count = count,
+			.max_ticks = max_ticks,
+			// The main loop runs at least one interval
+			.intervals = max(intervals, 1),
+			.size = GRID_SIZE,
+			.first_run = (int) ((long long) count * index / n_shards),
+			.n_runs = (int) ((long long) count * (index + 1) / n_shards - (long long) count * index / n_shards)
+	};
+	printf("Running replicas %d to %d of %d\n", header.first_run, header.first_run + header.n_runs - 1, count);
+
+	set_live_counter(LIVE_GRIDS, header.n_runs);
+	set_live_counter(LIVE_REMAINING, header.n_runs);
+
+	// The replicas are split statically between the workers, and their partial shards merged in order
+	ThreadPool * pool = create_thread_pool(n_threads);
+	int n_parts = pool->n_threads;
+	Shard * parts = malloc(n_parts * sizeof(*parts));
+	for (int i = 0; i < n_parts; i++) {
+		ShardHeader part = header;
+		part.first_run = header.first_run + header.n_runs * i / n_parts;
+		part.n_runs = header.first_run + header.n_runs * (i + 1) / n_parts - part.first_run;
+
+		parts[i] = create_shard(part);
+		submit_task(pool, run_shard_replicas, &parts[i]);
+	}
+	wait_thread_pool(pool);
+
+	Shard shard = create_shard(header);
+	shard.header.n_runs = 0;
+	for (int i = 0; i < n_parts; i++) {
+		merge_shard(&shard, parts[i]);
+		destroy_shard(parts[i]);
+	}
+	free(parts);
+	destroy_thread_pool(pool);
+
+	char path[64];
+	snprintf(path, sizeof(path), "shard-%d-of-%d.bin", index, n_shards);
+	bool ok = write_shard(shard, path);
+	if (ok) {
+		printf("Wrote %s\n", path);
+	}
+
+	destroy_shard(shard);
+
+	return ok ? 0 : 1;
+}
+
+/**
+ * Compare the first run of two shards (for qsort)
+ *
+ * @param a The first shard
+ * @param b The second shard
+ * @return The order of the shards
+ */
+int compare_shards(const void * a, const void * b) {
+	return ((const Shard *) a)->header.first_run - ((const Shard *) b)->header.first_run;
+}
+
+/**
+ * Merge shard files into merged.bin, in the order of their replicas so the result does not depend on the order of the
+ * files
+ * <p>
+ * The shards must come from the same run and cover contiguous replicas. Once they cover all the replicas of the run,
+ * the result is also written to ensemble.csv and time_series.csv, identical to the ones of a single shard.
+ * </p>
+ *
+ * @param paths The paths of the shard files
+ * @param n_paths The number of paths
+ * @return The exit code
+ */
+int run_merge(char ** paths, int n_paths) {
+	if (n_paths == 0) {
+		fprintf(stderr, "No shard to merge\n");
+		return 1;
+	}
+
+	Shard * shards = malloc(n_paths * sizeof(*shards));
+	int n_read = 0;
+	bool ok = true;
+	for (int i = 0; ok && i < n_paths; i++) {
+		ok = read_shard(paths[i], &shards[i]);
+		n_read += ok;
+	}
+
+	if (ok) {
+		qsort(shards, n_paths, sizeof(*shards), compare_shards);
+	}
+
+	for (int i = 1; ok && i < n_paths; i++) {
+		ShardHeader first = shards[0].header;
+		ShardHeader header = shards[i].header;
+
+		ok = header.model == first.model && header.wind_direction == first.wind_direction &&
+			 header.wind_speed == first.wind_speed && header.seed == first.seed && header.count == first.count &&
+			 header.max_ticks == first.max_ticks && header.intervals == first.intervals && header.size == first.size &&
+			 header.first_run == shards[i - 1].header.first_run + shards[i - 1].header.n_runs;
+		if (!ok) {
+			fprintf(stderr, "The shard of the replicas from %d does not continue the previous ones of the run\n",
+					header.first_run);
+		}
+	}
+
+	if (ok) {
+		Shard merged = create_shard(shards[0].header);
+		merged.header.n_runs = 0;
+		for (int i = 0; i < n_paths; i++) {
+			merge_shard(&merged, shards[i]);
+		}
+
+		ShardHeader header = merged.header;
+		printf("Merged replicas %d to %d of %d\n", header.first_run, header.first_run + header.n_runs - 1,
+			   header.count);
+		ok = write_shard(merged, "merged.bin");
+
+		if (ok && header.first_run == 0 && header.n_runs == header.count) {
+			write_ensemble_csv(merged.ensemble, "ensemble.csv");
+			write_time_series_csv(merged, "time_series.csv");
+		}
+
+		destroy_shard(merged);
+	}
+
+	for (int i = 0; i < n_read; i++) {
+		destroy_shard(shards[i]);
+	}
+	free(shards);
+
+	return ok ? 0 : 1;
+}
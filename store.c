@@ -0,0 +1,595 @@
+#pragma once
+#include "grid.c"
+
+/**
+ * The magic number at the start of the index of a results store
+ */
+const char STORE_MAGIC[8] = {'T', 'I', 'P', 'E', 'S', 'T', 'O', 'R'};
+/**
+ * The version of the results store format
+ */
+const int STORE_VERSION = 1;
+/**
+ * The number of runs of a block of the index, the filters skip the blocks whose range cannot match
+ */
+const int STORE_BLOCK_SIZE = 256;
+
+/**
+ * Represents a column of a results store, each one in its own file of 8 bytes per run
+ */
+typedef enum {
+	COLUMN_MODEL,
+	COLUMN_WIND_DIRECTION,
+	COLUMN_WIND_SPEED,
+	COLUMN_SIZE,
+	COLUMN_TICKS,
+	COLUMN_BURNED,
+	COLUMN_BURNING,
+	/**
+	 * The columns before this one are doubles that can be filtered, the ones after are uint64_t
+	 */
+	N_FILTERED_COLUMNS,
+	COLUMN_SEED = N_FILTERED_COLUMNS,
+	/**
+	 * The offset of the final state of the run in planes.bin
+	 */
+	COLUMN_PLANE_OFFSET,
+	/**
+	 * The length of the final state of the run in planes.bin
+	 */
+	COLUMN_PLANE_LENGTH,
+	N_COLUMNS
+} StoreColumn;
+
+/**
+ * The names of the columns, used for the file names and the filters
+ */
+const char * COLUMN_NAMES[N_COLUMNS] = {"model", "wind_direction", "wind_speed", "size", "ticks", "burned", "burning",
+										"seed", "plane_offset", "plane_length"};
+
+/**
+ * Represents an append-only results store : a directory holding a file per column, the compressed final states of the
+ * runs in planes.bin, and index.bin
+ * <p>
+ * The index holds the number of runs and the range of each filtered column per block of STORE_BLOCK_SIZE runs. It is
+ * written last, through a temporary file, when the store is closed and with each checkpoint of the main loop, so the
+ * runs appended after it are ignored if the program is killed.
+ * </p>
+ */
+typedef struct {
+	/**
+	 * The directory of the store
+	 */
+	char * path;
+	/**
+	 * The files of the columns
+	 */
+	FILE * columns[N_COLUMNS];
+	/**
+	 * The file of the final states
+	 */
+	FILE * planes;
+	/**
+	 * The number of runs
+	 */
+	int n_runs;
+	/**
+	 * The end of the final states of the runs in planes.bin
+	 */
+	uint64_t planes_end;
+	/**
+	 * The min of the filtered columns in each block (N_FILTERED_COLUMNS per block)
+	 */
+	double * minimums;
+	/**
+	 * The max of the filtered columns in each block (N_FILTERED_COLUMNS per block)
+	 */
+	double * maximums;
+	/**
+	 * The number of blocks the ranges can hold
+	 */
+	int capacity;
+	/**
+	 * Whether runs were appended since the index was written
+	 */
+	bool modified;
+} ResultStore;
+
+/**
+ * Open a file of a results store
+ *
+ * @param store The store
+ * @param name The name of the file in the directory of the store
+ * @return The file opened for reading and writing (created if needed), NULL on failure
+ */
+FILE * open_store_file(ResultStore * store, const char * name) {
+	char * file_name = malloc(strlen(store->path) + strlen(name) + 2);
+	sprintf(file_name, "%s/%s", store->path, name);
+
+	FILE * fp = fopen(file_name, "r+b");
+	if (!fp) {
+		fp = fopen(file_name, "w+b");
+	}
+	if (!fp) {
+		fprintf(stderr, "Failed to open file %s\n", file_name);
+	}
+
+	free(file_name);
+
+	return fp;
+}
+
+/**
+ * Grow the ranges of the blocks of a results store
+ *
+ * @param store The store
+ * @param n_blocks The number of blocks the ranges must hold
+ */
+void reserve_store_blocks(ResultStore * store, int n_blocks) {
+	if (n_blocks <= store->capacity) {
+		return;
+	}
+
+	store->capacity = max(n_blocks, 2 * store->capacity);
+	store->minimums = realloc(store->minimums, (size_t) store->capacity * N_FILTERED_COLUMNS * sizeof(double));
+	store->maximums = realloc(store->maximums, (size_t) store->capacity * N_FILTERED_COLUMNS * sizeof(double));
+}
+
+/**
+ * Close a results store, writing its index if runs were appended
+ *
+ * @param store The store to close
+ */
+void close_result_store(ResultStore * store);
+
+/**
+ * Open a results store, creating its directory if needed
+ *
+ * @param path The directory of the store
+ * @return The store, to close with close_result_store, NULL on failure
+ */
+ResultStore * open_result_store(const char * path) {
+	mkdir(path, 0700);
+
+	ResultStore * store = calloc(1, sizeof(*store));
+	store->path = strdup(path);
+
+	bool ok = true;
+	for (int c = 0; c < N_COLUMNS; c++) {
+		char name[64];
+		snprintf(name, sizeof(name), "%s.col", COLUMN_NAMES[c]);
+		store->columns[c] = open_store_file(store, name);
+		ok = ok && store->columns[c];
+	}
+	store->planes = open_store_file(store, "planes.bin");
+	ok = ok && store->planes;
+
+	// A store without index is empty
+	char * index_name = malloc(strlen(path) + 11);
+	sprintf(index_name, "%s/index.bin", path);
+	FILE * fp = fopen(index_name, "rb");
+	free(index_name);
+
+	if (ok && fp) {
+		char magic[sizeof(STORE_MAGIC)];
+		int version;
+		ok = fread(magic, sizeof(magic), 1, fp) == 1 && memcmp(magic, STORE_MAGIC, sizeof(magic)) == 0 &&
+			 fread(&version, sizeof(version), 1, fp) == 1 && version == STORE_VERSION &&
+			 fread(&store->n_runs, sizeof(store->n_runs), 1, fp) == 1 && store->n_runs >= 0 &&
+			 fread(&store->planes_end, sizeof(store->planes_end), 1, fp) == 1;
+
+		int n_blocks = ok ? (store->n_runs + STORE_BLOCK_SIZE - 1) / STORE_BLOCK_SIZE : 0;
+		size_t n_ranges = (size_t) n_blocks * N_FILTERED_COLUMNS;
+		reserve_store_blocks(store, n_blocks);
+		ok = ok && fread(store->minimums, sizeof(double), n_ranges, fp) == n_ranges &&
+			 fread(store->maximums, sizeof(double), n_ranges, fp) == n_ranges;
+	}
+
+	if (fp) {
+		fclose(fp);
+	}
+
+	if (!ok) {
+		fprintf(stderr, "Invalid results store %s\n", path);
+		close_result_store(store);
+		return NULL;
+	}
+
+	return store;
+}
+
+/**
+ * Write the index of a results store, through a temporary file so the index is always complete
+ *
+ * @param store The store
+ * @return True if the index was written, false otherwise
+ */
+bool write_store_index(ResultStore * store) {
+	char * temporary_path = malloc(strlen(store->path) + 15);
+	sprintf(temporary_path, "%s/index.bin.tmp", store->path);
+	char * path = malloc(strlen(store->path) + 11);
+	sprintf(path, "%s/index.bin", store->path);
+
+	// The runs must be on disk before the index pointing to them
+	bool ok = true;
+	for (int c = 0; c < N_COLUMNS; c++) {
+		ok = fflush(store->columns[c]) == 0 && ok;
+	}
+	ok = fflush(store->planes) == 0 && ok;
+
+	FILE * fp = fopen(temporary_path, "wb");
+	if (!fp) {
+		fprintf(stderr, "Failed to open file %s for writing\n", temporary_path);
+		free(temporary_path);
+		free(path);
+		return false;
+	}
+
+	int n_blocks = (store->n_runs + STORE_BLOCK_SIZE - 1) / STORE_BLOCK_SIZE;
+	size_t n_ranges = (size_t) n_blocks * N_FILTERED_COLUMNS;
+	ok = ok && fwrite(STORE_MAGIC, sizeof(STORE_MAGIC), 1, fp) == 1 &&
+		 fwrite(&STORE_VERSION, sizeof(STORE_VERSION), 1, fp) == 1 &&
+		 fwrite(&store->n_runs, sizeof(store->n_runs), 1, fp) == 1 &&
+		 fwrite(&store->planes_end, sizeof(store->planes_end), 1, fp) == 1 &&
+		 fwrite(store->minimums, sizeof(double), n_ranges, fp) == n_ranges &&
+		 fwrite(store->maximums, sizeof(double), n_ranges, fp) == n_ranges;
+
+	ok = fclose(fp) == 0 && ok && rename(temporary_path, path) == 0;
+	if (ok) {
+		store->modified = false;
+	} else {
+		fprintf(stderr, "Failed to write the index of %s\n", store->path);
+		remove(temporary_path);
+	}
+
+	free(temporary_path);
+	free(path);
+
+	return ok;
+}
+
+void close_result_store(ResultStore * store) {
+	if (store->modified) {
+		write_store_index(store);
+	}
+
+	for (int c = 0; c < N_COLUMNS; c++) {
+		if (store->columns[c]) {
+			fclose(store->columns[c]);
+		}
+	}
+	if (store->planes) {
+		fclose(store->planes);
+	}
+
+	free(store->minimums);
+	free(store->maximums);
+	free(store->path);
+	free(store);
+}
+
+/**
+ * Compress the final types of the tiles of a grid, as runs of (type, length - 1) bytes
+ *
+ * @param grid The grid
+ * @param length The length of the compressed plane
+ * @return The compressed plane, to free
+ */
+unsigned char * compress_plane(Grid grid, size_t * length) {
+	Tile * tiles = grid.data[0];
+	size_t n_tiles = (size_t) grid.size * grid.size;
+	unsigned char * plane = malloc(2 * n_tiles);
+
+	*length = 0;
+	for (size_t i = 0; i < n_tiles;) {
+		size_t run = 1;
+		while (run < 256 && i + run < n_tiles && tiles[i + run].current_type == tiles[i].current_type) {
+			run++;
+		}
+
+		plane[(*length)++] = tiles[i].current_type;
+		plane[(*length)++] = run - 1;
+		i += run;
+	}
+
+	return plane;
+}
+
+/**
+ * Append the final state of a run to a results store, the index is updated in memory until the store is closed
+ *
+ * @param store The store
+ * @param grid The grid of the run
+ * @param seed The seed of the run
+ */
+void append_run(ResultStore * store, Grid grid, uint64_t seed) {
+	size_t length;
+	unsigned char * plane = compress_plane(grid, &length);
+
+	double values[N_FILTERED_COLUMNS] = {grid.model, grid.wind_direction, grid.wind_speed, grid.size, grid.n_ticks,
+										 grid.statistics.burned, grid.statistics.burning};
+	uint64_t references[N_COLUMNS - N_FILTERED_COLUMNS] = {seed, store->planes_end, length};
+
+	// The runs past the index (appended before a crash) are overwritten
+	long offset = (long) store->n_runs * 8;
+	for (int c = 0; c < N_COLUMNS; c++) {
+		fseek(store->columns[c], offset, SEEK_SET);
+		if (c < N_FILTERED_COLUMNS) {
+			fwrite(&values[c], sizeof(double), 1, store->columns[c]);
+		} else {
+			fwrite(&references[c - N_FILTERED_COLUMNS], sizeof(uint64_t), 1, store->columns[c]);
+		}
+	}
+
+	fseek(store->planes, (long) store->planes_end, SEEK_SET);
+	fwrite(plane, 1, length, store->planes);
+	store->planes_end += length;
+	free(plane);
+
+	int block = store->n_runs / STORE_BLOCK_SIZE;
+	reserve_store_blocks(store, block + 1);
+	for (int c = 0; c < N_FILTERED_COLUMNS; c++) {
+		double * minimum = &store->minimums[block * N_FILTERED_COLUMNS + c];
+		double * maximum = &store->maximums[block * N_FILTERED_COLUMNS + c];
+		bool first = store->n_runs % STORE_BLOCK_SIZE == 0;
+
+		*minimum = first ? values[c] : fmin(*minimum, values[c]);
+		*maximum = first ? values[c] : fmax(*maximum, values[c]);
+	}
+
+	store->n_runs++;
+	store->modified = true;
+}
+
+/**
+ * Read the final types of the tiles of a run of a results store
+ *
+ * @param store The store
+ * @param run The index of the run
+ * @param types The types of the size * size tiles, at index x * size + y
+ * @param size The size of the grid of the run
+ * @return True if the final state was read, false otherwise
+ */
+bool read_run_plane(ResultStore * store, int run, TileType * types, int size) {
+	uint64_t offset;
+	uint64_t length;
+	bool ok = fseek(store->columns[COLUMN_PLANE_OFFSET], (long) run * 8, SEEK_SET) == 0 &&
+			  fread(&offset, sizeof(offset), 1, store->columns[COLUMN_PLANE_OFFSET]) == 1 &&
+			  fseek(store->columns[COLUMN_PLANE_LENGTH], (long) run * 8, SEEK_SET) == 0 &&
+			  fread(&length, sizeof(length), 1, store->columns[COLUMN_PLANE_LENGTH]) == 1;
+
+	unsigned char * plane = ok ? malloc(length) : NULL;
+	ok = ok && fseek(store->planes, (long) offset, SEEK_SET) == 0 && fread(plane, 1, length, store->planes) == length;
+
+	size_t n_tiles = (size_t) size * size;
+	size_t i = 0;
+	for (size_t p = 0; ok && p + 1 < length; p += 2) {
+		size_t run_length = plane[p + 1] + 1;
+		ok = i + run_length <= n_tiles;
+		for (size_t k = 0; ok && k < run_length; k++) {
+			types[i++] = plane[p];
+		}
+	}
+
+	free(plane);
+
+	return ok && i == n_tiles;
+}
+
+/**
+ * Represents a filter of the runs of a results store, like wind_speed>5
+ */
+typedef struct {
+	/**
+	 * The filtered column
+	 */
+	StoreColumn column;
+	/**
+	 * The comparison operator (<, <=, >, >=, == or !=)
+	 */
+	char operator[3];
+	/**
+	 * The value compared to
+	 */
+	double value;
+} StoreFilter;
+
+/**
+ * Parse a filter of the runs of a results store
+ *
+ * @param text The text of the filter, like wind_speed>5 (an empty text matches all the runs)
+ * @param filter The parsed filter
+ * @return True if the filter is valid, false otherwise
+ */
+bool parse_store_filter(const char * text, StoreFilter * filter) {
+	if (*text == '\0') {
+		*filter = (StoreFilter) {.column = COLUMN_MODEL, .operator = "!=", .value = NAN};
+		return true;
+	}
+
+	char name[32];
+	if (sscanf(text, "%31[a-z_]%2[<>=!]%lf", name, filter->operator, &filter->value) != 3) {
+		return false;
+	}
+
+	const char * operators[] = {"<", "<=", ">", ">=", "==", "!="};
+	bool valid = false;
+	for (int o = 0; o < 6; o++) {
+		valid = valid || strcmp(filter->operator, operators[o]) == 0;
+	}
+
+	for (int c = 0; valid && c < N_FILTERED_COLUMNS; c++) {
+		if (strcmp(name, COLUMN_NAMES[c]) == 0) {
+			filter->column = c;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Check whether a value matches a filter
+ *
+ * @param filter The filter
+ * @param value The value
+ * @return True if the value matches
+ */
+bool match_filter(StoreFilter filter, double value) {
+	switch (filter.operator[0]) {
+		case '<':
+			return filter.operator[1] ? value <= filter.value : value < filter.value;
+		case '>':
+			return filter.operator[1] ? value >= filter.value : value > filter.value;
+		case '=':
+			return value == filter.value;
+		default:
+			return value != filter.value;
+	}
+}
+
+/**
+ * Check whether a block of runs can hold values matching a filter
+ *
+ * @param filter The filter
+ * @param minimum The min of the column in the block
+ * @param maximum The max of the column in the block
+ * @return False if no value of the block matches
+ */
+bool match_filter_range(StoreFilter filter, double minimum, double maximum) {
+	switch (filter.operator[0]) {
+		case '<':
+			return match_filter(filter, minimum);
+		case '>':
+			return match_filter(filter, maximum);
+		case '=':
+			return filter.value >= minimum && filter.value <= maximum;
+		default:
+			return true;
+	}
+}
+
+/**
+ * Write the runs of a results store matching a filter to query.csv, reading only the blocks of the filtered column
+ * whose range can match, then the other columns of the matching runs
+ * <p>
+ * With export_csv, the final types of the matching runs are also written to query_grids.csv, a line per row of tiles
+ * after a "RUN [index]" line.
+ * </p>
+ *
+ * @param path The directory of the store
+ * @param text The filter, like wind_speed>5
+ * @param export_csv Whether to write the final types of the matching runs
+ * @return The exit code
+ */
+int run_store_query(const char * path, const char * text, bool export_csv) {
+	StoreFilter filter;
+	if (!parse_store_filter(text, &filter)) {
+		fprintf(stderr, "Invalid filter %s, expected a column, <, <=, >, >=, == or != and a number\n", text);
+		return 1;
+	}
+
+	ResultStore * store = open_result_store(path);
+	if (!store) {
+		return 1;
+	}
+
+	FILE * fp = fopen("query.csv", "w");
+	FILE * grids_fp = export_csv ? fopen("query_grids.csv", "w") : NULL;
+	if (!fp || (export_csv && !grids_fp)) {
+		fprintf(stderr, "Failed to open the query files for writing\n");
+		if (fp) {
+			fclose(fp);
+		}
+		if (grids_fp) {
+			fclose(grids_fp);
+		}
+		close_result_store(store);
+		return 1;
+	}
+
+	fprintf(fp, "run");
+	for (int c = 0; c < N_COLUMNS; c++) {
+		fprintf(fp, ",%s", COLUMN_NAMES[c]);
+	}
+	fprintf(fp, "\n");
+
+	double * values = malloc(STORE_BLOCK_SIZE * sizeof(*values));
+	TileType * types = NULL;
+	int n_matches = 0;
+	int n_read_blocks = 0;
+	int n_blocks = (store->n_runs + STORE_BLOCK_SIZE - 1) / STORE_BLOCK_SIZE;
+
+	for (int b = 0; b < n_blocks; b++) {
+		if (!match_filter_range(filter, store->minimums[b * N_FILTERED_COLUMNS + filter.column],
+								store->maximums[b * N_FILTERED_COLUMNS + filter.column])) {
+			continue;
+		}
+
+		int first = b * STORE_BLOCK_SIZE;
+		int n_values = min(STORE_BLOCK_SIZE, store->n_runs - first);
+		FILE * column = store->columns[filter.column];
+		if (fseek(column, (long) first * 8, SEEK_SET) != 0 ||
+			fread(values, sizeof(*values), n_values, column) != (size_t) n_values) {
+			fprintf(stderr, "Failed to read the column %s\n", COLUMN_NAMES[filter.column]);
+			break;
+		}
+		n_read_blocks++;
+
+		for (int r = 0; r < n_values; r++) {
+			if (!match_filter(filter, values[r])) {
+				continue;
+			}
+
+			int run = first + r;
+			double run_values[N_COLUMNS];
+			uint64_t references[N_COLUMNS];
+			for (int c = 0; c < N_COLUMNS; c++) {
+				fseek(store->columns[c], (long) run * 8, SEEK_SET);
+				fread(c < N_FILTERED_COLUMNS ? (void *) &run_values[c] : (void *) &references[c], 8, 1,
+					  store->columns[c]);
+			}
+
+			fprintf(fp, "%d", run);
+			for (int c = 0; c < N_COLUMNS; c++) {
+				if (c < N_FILTERED_COLUMNS) {
+					fprintf(fp, ",%g", run_values[c]);
+				} else {
+					fprintf(fp, ",%llu", (unsigned long long) references[c]);
+				}
+			}
+			fprintf(fp, "\n");
+
+			int size = (int) run_values[COLUMN_SIZE];
+			if (grids_fp) {
+				types = realloc(types, (size_t) size * size * sizeof(*types));
+				if (read_run_plane(store, run, types, size)) {
+					fprintf(grids_fp, "RUN %d\n", run);
+					for (int x = 0; x < size; x++) {
+						for (int y = 0; y < size; y++) {
+							fprintf(grids_fp, "%d,", types[x * size + y]);
+						}
+						fprintf(grids_fp, "\n");
+					}
+				} else {
+					fprintf(stderr, "Failed to read the final state of the run %d\n", run);
+				}
+			}
+
+			n_matches++;
+		}
+	}
+
+	printf("%d of %d runs match %s (%d of %d blocks read)\n", n_matches, store->n_runs, text, n_read_blocks,
+		   n_blocks);
+
+	free(values);
+	free(types);
+	fclose(fp);
+	if (grids_fp) {
+		fclose(grids_fp);
+	}
+	close_result_store(store);
+
+	return 0;
+}
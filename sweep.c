@@ -0,0 +1,257 @@
+#pragma once
+#include "grid.c"
+#include "pool.c"
+
+/**
+ * Represents a point of a parameter sweep
+ */
+typedef struct {
+	/**
+	 * The model of the grids
+	 */
+	int model;
+	/**
+	 * The wind speed
+	 */
+	double wind_speed;
+	/**
+	 * The wind direction
+	 */
+	double wind_direction;
+	/**
+	 * The spread table of the wind, shared by all the replicas of the point
+	 */
+	SpreadTable spread;
+} SweepPoint;
+
+/**
+ * Represents a replica of a point of a parameter sweep
+ */
+typedef struct {
+	/**
+	 * The point of the replica
+	 */
+	SweepPoint * point;
+	/**
+	 * The terrain shared by all the replicas
+	 */
+	Tile ** terrain;
+	/**
+	 * The size of the terrain
+	 */
+	int size;
+	/**
+	 * The seed of the replica
+	 */
+	uint64_t seed;
+	/**
+	 * The max number of ticks (-1 to run until the end)
+	 */
+	int max_ticks;
+	/**
+	 * The number of ticks that were run
+	 */
+	int ticks;
+	/**
+	 * The statistics of the grid at the end of the run
+	 */
+	Statistics statistics;
+} SweepRun;
+
+/**
+ * Parse a list of values, either separated by commas (1,2,5) or as an inclusive range (start:stop:step)
+ *
+ * @param text The text to parse
+ * @param values The parsed values, to free
+ * @return The number of values
+ */
+int parse_values(const char * text, double ** values) {
+	double start;
+	double stop;
+	double step;
+
+	if (sscanf(text, "%lf:%lf:%lf", &start, &stop, &step) == 3 && step > 0 && stop >= start) {
+		// A small epsilon so that the rounding errors do not drop the last value
+		int count = (int) floor((stop - start) / step + 1e-9) + 1;
+		*values = malloc(count * sizeof(**values));
+		for (int i = 0; i < count; i++) {
+			(*values)[i] = start + i * step;
+		}
+
+		return count;
+	}
+
+	int count = 1;
+	for (const char * c = text; *c; c++) {
+		count += *c == ',';
+	}
+
+	*values = malloc(count * sizeof(**values));
+	const char * c = text;
+	for (int i = 0; i < count; i++) {
+		char * end;
+		(*values)[i] = strtod(c, &end);
+		c = end + (*end == ',');
+	}
+
+	return count;
+}
+
+/**
+ * Run a replica of a sweep (run by the workers)
+ *
+ * @param argument The replica
+ */
+void run_sweep_run(void * argument) {
+	SweepRun * run = argument;
+
+	Grid grid = create_grid_from_tiles(run->point->model, run->terrain, run->size, run->seed,
+									   (Window) {.window = NULL, .surface = NULL}, 0, 0, false, false);
+	grid.wind_direction = run->point->wind_direction;
+	grid.wind_speed = run->point->wind_speed;
+	grid.spread = run->point->spread;
+
+	run->ticks = run_grid(&grid, run->max_ticks);
+	run->statistics = grid.statistics;
+
+	destroy_grid(grid);
+}
+
+/**
+ * Get the mean and the standard deviation of values
+ *
+ * @param values The values
+ * @param count The number of values
+ * @param std The standard deviation
+ * @return The mean
+ */
+double get_mean(const double * values, int count, double * std) {
+	double sum = 0;
+	double squares = 0;
+
+	for (int i = 0; i < count; i++) {
+		sum += values[i];
+		squares += values[i] * values[i];
+	}
+
+	double mean = sum / count;
+	*std = count > 1 ? sqrt(fmax(squares - count * mean * mean, 0) / (count - 1)) : 0;
+
+	return mean;
+}
+
+/**
+ * Run a parameter sweep : every combination of model, wind speed and wind direction is run replicas times on the same
+ * terrain, and summarized in sweep.csv
+ * <p>
+ * The replica r of every point uses the seed seed + r, so the points are compared with the same random numbers.
+ * </p>
+ *
+ * @param models The models
+ * @param wind_speeds The wind speeds
+ * @param wind_directions The wind directions
+ * @param replicas The number of replicas per point
+ * @param max_ticks The max number of ticks of a simulation (-1 to run until the end)
+ * @param n_threads The number of worker threads (the number of processors if not positive)
+ * @param seed The seed of the terrain and of the simulations
+ * @return The exit code
+ */
+int run_sweep(const char * models, const char * wind_speeds, const char * wind_directions, int replicas,
+			  int max_ticks, int n_threads, uint64_t seed) {
+	double * model_values;
+	double * speed_values;
+	double * direction_values;
+	int n_models = parse_values(models, &model_values);
+	int n_speeds = parse_values(wind_speeds, &speed_values);
+	int n_directions = parse_values(wind_directions, &direction_values);
+	int n_points = n_models * n_speeds * n_directions;
+	replicas = max(replicas, 1);
+
+	printf("Sweeping %d points with %d replicas\n", n_points, replicas);
+	fflush(stdout);
+
+	Random random;
+	seed_random(&random, seed);
+	Tile ** terrain = create_terrain(GRID_SIZE, &random, true);
+
+	// The spread table only depends on the wind, it is computed once per point
+	SweepPoint * points = malloc(n_points * sizeof(*points));
+	for (int m = 0; m < n_models; m++) {
+		for (int s = 0; s < n_speeds; s++) {
+			for (int d = 0; d < n_directions; d++) {
+				points[(m * n_speeds + s) * n_directions + d] = (SweepPoint) {
+						.model = (int) model_values[m],
+						.wind_speed = speed_values[s],
+						.wind_direction = direction_values[d],
+						.spread = create_spread_table(direction_values[d], speed_values[s])
+				};
+			}
+		}
+	}
+
+	ThreadPool * pool = create_thread_pool(n_threads);
+	SweepRun * runs = malloc((size_t) n_points * replicas * sizeof(*runs));
+	for (int p = 0; p < n_points; p++) {
+		for (int r = 0; r < replicas; r++) {
+			SweepRun * run = &runs[(size_t) p * replicas + r];
+			*run = (SweepRun) {
+					.point = &points[p],
+					.terrain = terrain,
+					.size = GRID_SIZE,
+					.seed = seed + r,
+					.max_ticks = max_ticks
+			};
+			submit_task(pool, run_sweep_run, run);
+		}
+	}
+	wait_thread_pool(pool);
+
+	FILE * fp = fopen("sweep.csv", "w");
+	if (!fp) {
+		fprintf(stderr, "Failed to open file sweep.csv for writing\n");
+	} else {
+		fprintf(fp, "model,wind_speed,wind_direction,replicas,burned_mean,burned_std,burned_min,burned_max,"
+					"ticks_mean,ticks_std,spread_mean,spread_std\n");
+
+		double * burned = malloc(replicas * sizeof(*burned));
+		double * ticks = malloc(replicas * sizeof(*ticks));
+		double * spread = malloc(replicas * sizeof(*spread));
+		for (int p = 0; p < n_points; p++) {
+			double burned_min = INFINITY;
+			double burned_max = 0;
+
+			for (int r = 0; r < replicas; r++) {
+				SweepRun run = runs[(size_t) p * replicas + r];
+				burned[r] = run.statistics.burned + run.statistics.burning;
+				ticks[r] = run.ticks;
+				spread[r] = run.statistics.front - run.statistics.origin;
+				burned_min = fmin(burned_min, burned[r]);
+				burned_max = fmax(burned_max, burned[r]);
+			}
+
+			double burned_std, ticks_std, spread_std;
+			double burned_mean = get_mean(burned, replicas, &burned_std);
+			double ticks_mean = get_mean(ticks, replicas, &ticks_std);
+			double spread_mean = get_mean(spread, replicas, &spread_std);
+
+			fprintf(fp, "%d,%g,%g,%d,%.2f,%.2f,%.0f,%.0f,%.2f,%.2f,%.3f,%.3f\n", points[p].model,
+					points[p].wind_speed, points[p].wind_direction, replicas, burned_mean, burned_std, burned_min,
+					burned_max, ticks_mean, ticks_std, spread_mean, spread_std);
+		}
+
+		free(burned);
+		free(ticks);
+		free(spread);
+		fclose(fp);
+	}
+
+	destroy_thread_pool(pool);
+	free(runs);
+	free(points);
+	free_tiles(terrain);
+	free(model_values);
+	free(speed_values);
+	free(direction_values);
+
+	return fp ? 0 : 1;
+}
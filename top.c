@@ -0,0 +1,106 @@
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include "live.c"
+
+/**
+ * Read the counters of a live statistics file
+ *
+ * @param stats The mapped file
+ * @param counters The read counters
+ */
+void read_live_counters(const LiveStats * stats, int64_t * counters) {
+	for (int c = 0; c < LIVE_COUNTER_COUNT; c++) {
+		counters[c] = __atomic_load_n(&stats->counters[c], __ATOMIC_RELAXED);
+	}
+}
+
+/**
+ * Watch the live statistics published by a run (--live_stats), printing a line per refresh until the run finishes
+ * <p>
+ * The program can be launched with the following arguments:
+ * <ul>
+ * <li>[path]: The live statistics file (defaults to live_stats.bin)</li>
+ * <li>--interval [seconds]: The time between two refreshes (defaults to 1)</li>
+ * <li>--once: Print the counters once and exit</li>
+ * </ul>
+ * </p>
+ * @param argc The number of arguments
+ * @param argv The arguments
+ * @return The exit code
+ */
+int main(int argc, char * argv[]) {
+	const char * path = "live_stats.bin";
+	double interval = 1;
+	bool once = false;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--interval") == 0) {
+			if (i + 1 < argc) {
+				interval = atof(argv[++i]);
+			}
+		} else if (strcmp(argv[i], "--once") == 0) {
+			once = true;
+		} else if (strcmp(argv[i], "--help") == 0) {
+			printf("Usage: %s [path] --interval [seconds] --once\n", argv[0]);
+			return 0;
+		} else {
+			path = argv[i];
+		}
+	}
+
+	int fd = open(path, O_RDONLY);
+	LiveStats * stats = fd < 0 ? MAP_FAILED : mmap(NULL, sizeof(LiveStats), PROT_READ, MAP_SHARED, fd, 0);
+	if (fd >= 0) {
+		close(fd);
+	}
+	if (stats == MAP_FAILED || memcmp(stats->magic, LIVE_MAGIC, sizeof(LIVE_MAGIC)) != 0 ||
+		stats->version != LIVE_VERSION) {
+		fprintf(stderr, "Invalid live statistics file %s\n", path);
+		return 1;
+	}
+
+	printf("%8s %10s %12s %12s %10s %10s %7s %7s\n", "elapsed", "remaining", "ticks", "ticks/s", "burning",
+		   "memory_mb", "exports", "tasks");
+
+	int64_t previous[LIVE_COUNTER_COUNT];
+	read_live_counters(stats, previous);
+	struct timespec last;
+	clock_gettime(CLOCK_MONOTONIC, &last);
+
+	while (true) {
+		if (!once) {
+			struct timespec delay = {(time_t) interval, (long) ((interval - (time_t) interval) * 1e9)};
+			nanosleep(&delay, NULL);
+		}
+
+		int64_t counters[LIVE_COUNTER_COUNT];
+		read_live_counters(stats, counters);
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		double seconds = (double) (now.tv_sec - last.tv_sec) + (now.tv_nsec - last.tv_nsec) / 1e9;
+
+		// The rate is measured between two refreshes, so reading the file does not touch the run
+		printf("%8lld %5lld/%-4lld %12lld %12.1f %10lld %10.1f %7lld %7lld\n",
+			   (long long) (time(NULL) - stats->start_time), (long long) counters[LIVE_REMAINING],
+			   (long long) counters[LIVE_GRIDS], (long long) counters[LIVE_TICKS],
+			   seconds > 0 ? (counters[LIVE_TICKS] - previous[LIVE_TICKS]) / seconds : 0.,
+			   (long long) counters[LIVE_BURNING], counters[LIVE_MEMORY] / (1024. * 1024.),
+			   (long long) counters[LIVE_EXPORT_QUEUE], (long long) counters[LIVE_QUEUED_TASKS]);
+		fflush(stdout);
+
+		// A run killed before finishing is detected by its process id
+		bool finished = __atomic_load_n(&stats->finished, __ATOMIC_ACQUIRE) ||
+						(kill(stats->pid, 0) != 0 && errno == ESRCH);
+		if (once || finished) {
+			break;
+		}
+
+		memcpy(previous, counters, sizeof(previous));
+		last = now;
+	}
+
+	munmap(stats, sizeof(LiveStats));
+
+	return 0;
+}
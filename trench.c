@@ -0,0 +1,329 @@
+#pragma once
+#include <time.h>
+#include "sweep.c"
+
+/**
+ * The directions a trench can follow (horizontal, vertical and the two diagonals)
+ */
+const Point TRENCH_DIRECTIONS[4] = {{0, 1}, {1, 0}, {1, 1}, {1, -1}};
+
+/**
+ * Represents a trench layout : a straight line of trench tiles
+ */
+typedef struct {
+	/**
+	 * The center of the trench
+	 */
+	Point center;
+	/**
+	 * The index of the direction of the trench in TRENCH_DIRECTIONS
+	 */
+	int direction;
+	/**
+	 * The number of tiles of the trench
+	 */
+	int length;
+} TrenchLayout;
+
+/**
+ * Represents a candidate layout and its score
+ */
+typedef struct {
+	/**
+	 * The layout of the candidate (a length of 0 for no trench)
+	 */
+	TrenchLayout layout;
+	/**
+	 * The terrain shared by all the candidates, without fire
+	 */
+	Tile ** terrain;
+	/**
+	 * The size of the terrain
+	 */
+	int size;
+	/**
+	 * The model of the grids
+	 */
+	int model;
+	/**
+	 * The wind direction
+	 */
+	double wind_direction;
+	/**
+	 * The wind speed
+	 */
+	double wind_speed;
+	/**
+	 * The point set on fire
+	 */
+	Point ignition;
+	/**
+	 * The number of runs scoring the candidate
+	 */
+	int runs;
+	/**
+	 * The max number of ticks of a run (-1 to run until the end)
+	 */
+	int max_ticks;
+	/**
+	 * The seed of the first run, the run r uses seed + r
+	 */
+	uint64_t seed;
+	/**
+	 * The mean burned area (burning and burnt tiles at the end of the runs)
+	 */
+	double burned_mean;
+	/**
+	 * The standard deviation of the burned area
+	 */
+	double burned_std;
+} TrenchCandidate;
+
+/**
+ * Dig a trench in tiles, the water tiles and the ignition point are left as they are
+ *
+ * @param tiles The tiles
+ * @param size The size of the tiles
+ * @param layout The layout of the trench
+ * @param ignition The point set on fire
+ */
+void dig_trench(Tile ** tiles, int size, TrenchLayout layout, Point ignition) {
+	Point direction = TRENCH_DIRECTIONS[layout.direction];
+
+	for (int k = 0; k < layout.length; k++) {
+		int offset = k - layout.length / 2;
+		Point point = {layout.center.x + offset * direction.x, layout.center.y + offset * direction.y};
+
+		if (point.x < 0 || point.x >= size || point.y < 0 || point.y >= size ||
+			(point.x == ignition.x && point.y == ignition.y) || tiles[point.x][point.y].current_type == WATER) {
+			continue;
+		}
+
+		tiles[point.x][point.y].current_type = TRENCH;
+		tiles[point.x][point.y].default_type = TRENCH;
+	}
+}
+
+/**
+ * Score a candidate with runs from the same fire state (run by the workers)
+ *
+ * @param argument The candidate
+ */
+void run_trench_candidate(void * argument) {
+	TrenchCandidate * candidate = argument;
+
+	// The runs are forked from the same ignited grid, so the tiles and the spread table are prepared once
+	Grid origin = create_grid_from_tiles(candidate->model, candidate->terrain, candidate->size, candidate->seed,
+										 (Window) {.window = NULL, .surface = NULL}, 0, 0, false, false);
+	dig_trench(origin.data, candidate->size, candidate->layout, candidate->ignition);
+	ignite(&origin, candidate->ignition);
+	set_wind(&origin, candidate->wind_direction, candidate->wind_speed);
+
+	double * burned = malloc(candidate->runs * sizeof(*burned));
+	for (int r = 0; r < candidate->runs; r++) {
+		Grid grid = fork_grid(&origin, candidate->seed + r);
+
+		run_grid(&grid, candidate->max_ticks);
+		burned[r] = grid.statistics.burned + grid.statistics.burning;
+
+		destroy_grid(grid);
+	}
+
+	candidate->burned_mean = get_mean(burned, candidate->runs, &candidate->burned_std);
+
+	free(burned);
+	destroy_grid(origin);
+}
+
+/**
+ * Create a random layout around the ignition point
+ *
+ * @param random The random number generator
+ * @param size The size of the terrain
+ * @param ignition The point set on fire
+ * @param budget The number of trench tiles
+ * @return The created layout
+ */
+TrenchLayout create_random_layout(Random * random, int size, Point ignition, int budget) {
+	int radius = max(budget, size / 4);
+
+	return (TrenchLayout) {
+			.center = {
+					max(0, min(size - 1, ignition.x - radius + get_random(random, 2 * radius + 1))),
+					max(0, min(size - 1, ignition.y - radius + get_random(random, 2 * radius + 1)))
+			},
+			.direction = get_random(random, 4),
+			.length = budget
+	};
+}
+
+/**
+ * Create a layout close to another one : the center is moved by up to a quarter of the budget, and the direction may
+ * change
+ *
+ * @param random The random number generator
+ * @param size The size of the terrain
+ * @param layout The layout to move
+ * @return The created layout
+ */
+TrenchLayout mutate_layout(Random * random, int size, TrenchLayout layout) {
+	int step = max(1, layout.length / 4);
+
+	layout.center.x = max(0, min(size - 1, layout.center.x - step + get_random(random, 2 * step + 1)));
+	layout.center.y = max(0, min(size - 1, layout.center.y - step + get_random(random, 2 * step + 1)));
+	if (get_random(random, 4) == 0) {
+		layout.direction = get_random(random, 4);
+	}
+
+	return layout;
+}
+
+/**
+ * Write a layout to a json file in the format of grid.json, so it can be loaded back as the input map
+ *
+ * @param terrain The terrain
+ * @param size The size of the terrain
+ * @param layout The layout of the trench
+ * @param ignition The point set on fire
+ * @param file_name The name of the file
+ */
+void write_trench_json(Tile ** terrain, int size, TrenchLayout layout, Point ignition, const char * file_name) {
+	FILE * fp = fopen(file_name, "w");
+	if (!fp) {
+		fprintf(stderr, "Failed to open file %s for writing\n", file_name);
+		return;
+	}
+
+	Tile ** tiles = copy_grid(terrain, size);
+	dig_trench(tiles, size, layout, ignition);
+	tiles[ignition.x][ignition.y].current_type = FIRE;
+
+	fprintf(fp, "{\"grid\":[");
+	for (int i = 0; i < size; i++) {
+		fprintf(fp, i ? ",\n[" : "\n[");
+		for (int j = 0; j < size; j++) {
+			fprintf(fp, j ? ",%d" : "%d", tiles[i][j].current_type);
+		}
+		fprintf(fp, "]");
+	}
+	fprintf(fp, "\n]}\n");
+
+	free_tiles(tiles);
+	fclose(fp);
+}
+
+/**
+ * Search the trench layout that minimizes the expected burned area from an ignition point, and write the candidates
+ * in trench.csv and the best layout in trench.json
+ * <p>
+ * Half of the candidates are random straight trenches around the ignition point, the other half are moves of the best
+ * candidate so far. Every candidate is scored with the same seeds, so the candidates are compared with the same random
+ * numbers. The candidates of a batch are scored in parallel.
+ * </p>
+ *
+ * @param model The model of the grids
+ * @param wind_direction The wind direction
+ * @param wind_speed The wind speed
+ * @param budget The number of trench tiles
+ * @param ignition The point set on fire
+ * @param n_candidates The number of candidates to evaluate
+ * @param runs The number of runs per candidate
+ * @param max_ticks The max number of ticks of a run (-1 to run until the end)
+ * @param n_threads The number of worker threads (the number of processors if not positive)
+ * @param seed The seed of the terrain, of the search and of the runs
+ * @return The exit code
+ */
+int run_trench_optimizer(int model, double wind_direction, double wind_speed, int budget, Point ignition,
+						 int n_candidates, int runs, int max_ticks, int n_threads, uint64_t seed) {
+	Random random;
+	seed_random(&random, seed);
+
+	Tile ** terrain = create_terrain(GRID_SIZE, &random, false);
+	ignition.x = max(0, min(GRID_SIZE - 1, ignition.x));
+	ignition.y = max(0, min(GRID_SIZE - 1, ignition.y));
+	n_candidates = max(n_candidates, 1);
+	runs = max(runs, 1);
+
+	ThreadPool * pool = create_thread_pool(n_threads);
+	int batch_size = 2 * pool->n_threads;
+
+	// The first candidate is the baseline without trench
+	TrenchCandidate * candidates = malloc((n_candidates + 1) * sizeof(*candidates));
+	for (int i = 0; i <= n_candidates; i++) {
+		candidates[i] = (TrenchCandidate) {
+				.layout = {.center = ignition, .direction = 0, .length = 0},
+				.terrain = terrain,
+				.size = GRID_SIZE,
+				.model = model,
+				.wind_direction = wind_direction,
+				.wind_speed = wind_speed,
+				.ignition = ignition,
+				.runs = runs,
+				.max_ticks = max_ticks,
+				.seed = seed
+		};
+	}
+
+	printf("Searching %d trench layouts of %d tiles with %d runs each\n", n_candidates, budget, runs);
+	fflush(stdout);
+
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	run_trench_candidate(&candidates[0]);
+	int best = 0;
+
+	for (int first = 1; first <= n_candidates; first += batch_size) {
+		int last = min(first + batch_size, n_candidates + 1);
+
+		for (int i = first; i < last; i++) {
+			candidates[i].layout = i <= n_candidates / 2 || best == 0 ?
+								   create_random_layout(&random, GRID_SIZE, ignition, budget) :
+								   mutate_layout(&random, GRID_SIZE, candidates[best].layout);
+			submit_task(pool, run_trench_candidate, &candidates[i]);
+		}
+		wait_thread_pool(pool);
+
+		for (int i = first; i < last; i++) {
+			if (candidates[i].burned_mean < candidates[best].burned_mean) {
+				best = i;
+			}
+		}
+	}
+
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	double seconds = (double) (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+	TrenchCandidate result = candidates[best];
+	printf("Evaluated %d candidates in %.2f s (%.2f candidates/s, %.1f runs/s)\n", n_candidates + 1, seconds,
+		   (n_candidates + 1) / seconds, (double) (n_candidates + 1) * runs / seconds);
+	printf("Best trench centered on (%d, %d) in direction (%d, %d): burned %.1f +- %.1f tiles, %.1f without trench\n",
+		   result.layout.center.x, result.layout.center.y, TRENCH_DIRECTIONS[result.layout.direction].x,
+		   TRENCH_DIRECTIONS[result.layout.direction].y, result.burned_mean, result.burned_std,
+		   candidates[0].burned_mean);
+
+	FILE * fp = fopen("trench.csv", "w");
+	if (!fp) {
+		fprintf(stderr, "Failed to open file trench.csv for writing\n");
+	} else {
+		fprintf(fp, "candidate,center_x,center_y,direction_x,direction_y,length,burned_mean,burned_std\n");
+
+		for (int i = 0; i <= n_candidates; i++) {
+			TrenchLayout layout = candidates[i].layout;
+			fprintf(fp, "%d,%d,%d,%d,%d,%d,%.2f,%.2f\n", i, layout.center.x, layout.center.y,
+					TRENCH_DIRECTIONS[layout.direction].x, TRENCH_DIRECTIONS[layout.direction].y, layout.length,
+					candidates[i].burned_mean, candidates[i].burned_std);
+		}
+
+		fclose(fp);
+	}
+
+	write_trench_json(terrain, GRID_SIZE, result.layout, ignition, "trench.json");
+
+	destroy_thread_pool(pool);
+	free(candidates);
+	free_tiles(terrain);
+
+	return fp ? 0 : 1;
+}
@@ -1,5 +1,6 @@
 #include <SDL2/SDL.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 /**
  * Represents the size of the grid
@@ -56,6 +57,38 @@ typedef struct {
 	int y;
 } Point;
 
+/**
+ * Represents the state of a random number generator (xoshiro256**)
+ */
+typedef struct {
+	/**
+	 * The internal state of the generator
+	 */
+	uint64_t s[4];
+} Random;
+
+/**
+ * Represents an arena : a region of memory allocated linearly and released at once
+ */
+typedef struct {
+	/**
+	 * The start of the allocatable memory
+	 */
+	char * base;
+	/**
+	 * The size of the allocatable memory
+	 */
+	size_t capacity;
+	/**
+	 * The size of the allocated memory
+	 */
+	size_t used;
+	/**
+	 * The size of the mapping holding the arena (the arena is stored at its start)
+	 */
+	size_t mapped;
+} Arena;
+
 /**
  * Represents a tile type
  */
@@ -110,20 +143,207 @@ typedef struct {
 	 * The state of the tile (for example, the state of a fire)
 	 */
 	int state;
+	/**
+	 * The tick at which the tile was set on fire (0 if it was on fire from the start, -1 if it never burnt)
+	 */
+	int ignition_tick;
 	/**
 	 * The altitude of the tile
 	 */
 	double altitude;
 } Tile;
 
+/**
+ * Represents the statistics of a grid, kept up to date as the tiles change
+ */
+typedef struct {
+	/**
+	 * The number of tiles on fire
+	 */
+	int burning;
+	/**
+	 * The number of burnt tiles
+	 */
+	int burned;
+	/**
+	 * The length of the fire front, ie the number of edges between a tile on fire and a tile that can burn
+	 */
+	int perimeter;
+	/**
+	 * The bounding box of the tiles that have been on fire (min_x > max_x if there was no fire)
+	 */
+	int min_x;
+	int min_y;
+	int max_x;
+	int max_y;
+	/**
+	 * The furthest position reached by the fire along the wind axis
+	 */
+	double front;
+	/**
+	 * The position of the fire along the wind axis before the first tick
+	 */
+	double origin;
+	/**
+	 * The progression of the front along the wind axis during the last tick (in tiles per tick)
+	 */
+	double rate_of_spread;
+} Statistics;
+
+/**
+ * Represents the spread probabilities of a grid that only depend on the wind, for each direction (index
+ * (dx + 1) * 3 + (dy + 1))
+ */
+typedef struct {
+	/**
+	 * Whether the table has been computed for the wind of the grid
+	 */
+	bool ready;
+	/**
+	 * The probability for a tile of each type to burn (Alexandridis model)
+	 */
+	double burn[TILE_TYPE_SIZE][9];
+	/**
+	 * The wind part of phi (Rothermel model)
+	 */
+	double wind_phi[9];
+	/**
+	 * The probability for a tile to burn on a flat terrain (Rothermel model)
+	 */
+	double flat_burn[9];
+} SpreadTable;
+
+/**
+ * Represents a wind changing over the map and over time : a coarse raster of winds for each keyframe, stretched over
+ * the grids
+ */
+typedef struct {
+	/**
+	 * The number of columns of the raster (along x)
+	 */
+	int width;
+	/**
+	 * The number of rows of the raster (along y)
+	 */
+	int height;
+	/**
+	 * The number of keyframes
+	 */
+	int n_keyframes;
+	/**
+	 * The first tick of each keyframe, in increasing order (the first keyframe also holds before its tick)
+	 */
+	int * ticks;
+	/**
+	 * The wind direction of each cell of each keyframe (index (keyframe * width + x) * height + y)
+	 */
+	double * directions;
+	/**
+	 * The wind speed of each cell of each keyframe (same index)
+	 */
+	double * speeds;
+} WindField;
+
+/**
+ * Represents how the fire spreads to the neighbors of a tile in a pass of a model
+ */
+typedef enum {
+	/**
+	 * Each type of tile burns with a fixed probability 1 / burn[type] (models 0 and 1)
+	 */
+	SPREAD_FIXED,
+	/**
+	 * The probability depends on the type of the tile and on the wind, from the spread table (Alexandridis model)
+	 */
+	SPREAD_ALEXANDRIDIS,
+	/**
+	 * The probability depends on the slope and on the wind, the types with a non-zero burn can burn (Rothermel model)
+	 */
+	SPREAD_ROTHERMEL
+} SpreadRule;
+
+/**
+ * Represents a pass of the rules of a model over a tile on fire : the fire spreads to some neighbors, then the tile
+ * changes state
+ */
+typedef struct {
+	/**
+	 * How the fire spreads
+	 */
+	SpreadRule rule;
+	/**
+	 * The number of neighbors
+	 */
+	int n_neighbors;
+	/**
+	 * The offsets of the neighbors, in the order of the random draws
+	 */
+	Point neighbors[8];
+	/**
+	 * The burn of each type of tile, see SpreadRule (0 if the type cannot burn)
+	 */
+	int burn[TILE_TYPE_SIZE];
+	/**
+	 * Whether only the new fires spread, the others burning out
+	 */
+	bool spread_once;
+	/**
+	 * The probability for a fire to change state is 1 / state_change (1 to change on every pass without drawing)
+	 */
+	int state_change;
+} ModelPass;
+
+/**
+ * Represents the rules of a model, applied to each tile on fire on every tick
+ */
+typedef struct {
+	/**
+	 * The number of passes
+	 */
+	int n_passes;
+	/**
+	 * The passes, applied in order
+	 */
+	ModelPass passes[2];
+} Model;
+
 /**
  * Represents a grid
  */
 typedef struct {
 	/**
-	 * The data of the grid
+	 * The data of the grid, rows point into a single contiguous block of size * size tiles
 	 */
 	Tile ** data;
+	/**
+	 * The buffer the next tick is computed into, swapped with data after each tick
+	 */
+	Tile ** scratch;
+	/**
+	 * Whether data is borrowed from another grid (a fork), it is then copied before being modified
+	 */
+	bool shared;
+	/**
+	 * The arena holding the tiles of the grid (NULL if they are allocated on the heap)
+	 */
+	Arena * arena;
+	/**
+	 * The number of tiles on fire in each block of BLOCK_SIZE x BLOCK_SIZE tiles (index bx * n_blocks + by), NULL to
+	 * update the whole grid on every tick
+	 */
+	int * block_fires;
+	/**
+	 * The blocks with tiles on fire at the start of the current tick, in row-major order
+	 */
+	int * active_blocks;
+	/**
+	 * The size of the grid (number of tiles per side)
+	 */
+	int size;
+	/**
+	 * The random number generator of the grid
+	 */
+	Random random;
 	/**
 	 * The window of the grid
 	 */
@@ -164,8 +384,59 @@ typedef struct {
 	 * Number of elapsed time intervals
 	 */
 	int n_intervals;
+	/**
+	 * Number of elapsed ticks
+	 */
+	int n_ticks;
+	/**
+	 * The statistics of the grid
+	 */
+	Statistics statistics;
+	/**
+	 * The spread probabilities of the grid, computed before the first tick if they are not ready
+	 */
+	SpreadTable spread;
+	/**
+	 * The spread probabilities of each cell of WIND_CELL_SIZE x WIND_CELL_SIZE tiles with the wind field (index
+	 * cx * n_cells + cy), NULL until the first use
+	 */
+	SpreadTable * wind_tables;
+	/**
+	 * The keyframe of the wind field each spread table was computed for (-1 if it was not computed)
+	 */
+	int * wind_keyframes;
 } Grid;
 
+/**
+ * Represents the aggregation of the final states of several grids of the same size
+ */
+typedef struct {
+	/**
+	 * The size of the grids
+	 */
+	int size;
+	/**
+	 * The number of grids added to the ensemble
+	 */
+	int count;
+	/**
+	 * The number of grids ending with each type, for each tile (index (x * size + y) * TILE_TYPE_SIZE + type)
+	 */
+	int * types;
+	/**
+	 * The number of grids in which each tile has been on fire (index x * size + y)
+	 */
+	int * burns;
+	/**
+	 * The sum of the ignition ticks of each tile, over the grids in which it has been on fire (index x * size + y)
+	 */
+	long long * ignition_ticks;
+	/**
+	 * The arena holding the arrays of the ensemble
+	 */
+	Arena * arena;
+} Ensemble;
+
 /**
  * Get a color according to a tile type and a state
  *
@@ -0,0 +1,250 @@
+#pragma once
+#include <cjson/cJSON.h>
+#include <math.h>
+
+/**
+ * The size of the cells sharing a spread table with the wind field
+ */
+const int WIND_CELL_SIZE = 8;
+
+/**
+ * The wind field of the grids, NULL for the uniform wind of each grid (set by --wind_field)
+ */
+WindField * wind_field = NULL;
+
+SpreadTable create_spread_table(double wind_direction, double wind_speed);
+
+/**
+ * Read the values of a wind field in a keyframe : a number for the whole map, or an array of columns of numbers
+ *
+ * @param field The wind field, its size set by the first array
+ * @param values The values of the keyframe in the file
+ * @param out The values of the cells of the keyframe
+ * @return True if the values were read, false otherwise
+ */
+bool read_wind_values(WindField * field, cJSON * values, double * out) {
+	if (cJSON_IsNumber(values)) {
+		for (int i = 0; i < field->width * field->height; i++) {
+			out[i] = values->valuedouble;
+		}
+		return true;
+	}
+
+	if (cJSON_GetArraySize(values) != field->width) {
+		return false;
+	}
+
+	for (int x = 0; x < field->width; x++) {
+		cJSON * column = cJSON_GetArrayItem(values, x);
+		if (cJSON_GetArraySize(column) != field->height) {
+			return false;
+		}
+
+		for (int y = 0; y < field->height; y++) {
+			cJSON * value = cJSON_GetArrayItem(column, y);
+			if (!cJSON_IsNumber(value)) {
+				return false;
+			}
+			out[x * field->height + y] = value->valuedouble;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Destroy a wind field
+ *
+ * @param field The wind field to destroy (can be NULL)
+ */
+void destroy_wind_field(WindField * field) {
+	if (field) {
+		free(field->ticks);
+		free(field->directions);
+		free(field->speeds);
+		free(field);
+	}
+}
+
+/**
+ * Read a wind field from a json file
+ * <p>
+ * The file holds the keyframes in increasing order of tick, for example
+ * {"keyframes": [{"tick": 0, "direction": [[90, 80], [90, 60]], "speed": 4}, {"tick": 100, "direction": 270, "speed": 8}]}.
+ * The direction and the speed of a keyframe are either a number for the whole map, or width columns of height cells
+ * stretched over the grids (the same size for all the keyframes).
+ * </p>
+ *
+ * @param file_name The name of the file
+ * @return The wind field, to destroy with destroy_wind_field, NULL if the file is invalid
+ */
+WindField * read_wind_field(const char * file_name) {
+	FILE * file = fopen(file_name, "r");
+	char * content = readfile(file);
+	if (file) {
+		fclose(file);
+	}
+
+	cJSON * json = cJSON_Parse(content);
+	free(content);
+	cJSON * keyframes = cJSON_GetObjectItem(json, "keyframes");
+	int n_keyframes = cJSON_GetArraySize(keyframes);
+	if (n_keyframes == 0) {
+		fprintf(stderr, "Failed to read the keyframes of the wind field %s\n", file_name);
+		cJSON_Delete(json);
+		return NULL;
+	}
+
+	// The size of the raster is the one of the first array
+	WindField * field = malloc(sizeof(*field));
+	*field = (WindField) {.width = 1, .height = 1, .n_keyframes = n_keyframes};
+	cJSON * keyframe;
+	cJSON_ArrayForEach(keyframe, keyframes) {
+		cJSON * values = cJSON_GetObjectItem(keyframe, "direction");
+		values = cJSON_IsArray(values) ? values : cJSON_GetObjectItem(keyframe, "speed");
+
+		if (cJSON_IsArray(values)) {
+			field->width = cJSON_GetArraySize(values);
+			field->height = cJSON_GetArraySize(cJSON_GetArrayItem(values, 0));
+			break;
+		}
+	}
+
+	size_t n_cells = (size_t) field->width * field->height;
+	field->ticks = malloc(n_keyframes * sizeof(*field->ticks));
+	field->directions = malloc(n_keyframes * n_cells * sizeof(*field->directions));
+	field->speeds = malloc(n_keyframes * n_cells * sizeof(*field->speeds));
+
+	bool ok = field->width > 0 && field->height > 0;
+	for (int k = 0; ok && k < n_keyframes; k++) {
+		keyframe = cJSON_GetArrayItem(keyframes, k);
+		cJSON * tick = cJSON_GetObjectItem(keyframe, "tick");
+
+		field->ticks[k] = tick ? tick->valueint : 0;
+		ok = cJSON_IsNumber(tick) && (k == 0 || field->ticks[k] > field->ticks[k - 1]) &&
+			 read_wind_values(field, cJSON_GetObjectItem(keyframe, "direction"), field->directions + k * n_cells) &&
+			 read_wind_values(field, cJSON_GetObjectItem(keyframe, "speed"), field->speeds + k * n_cells);
+	}
+	cJSON_Delete(json);
+
+	if (!ok) {
+		fprintf(stderr, "Invalid wind field %s\n", file_name);
+		destroy_wind_field(field);
+		return NULL;
+	}
+
+	return field;
+}
+
+/**
+ * Get the keyframe of a wind field at a tick
+ *
+ * @param field The wind field
+ * @param tick The tick
+ * @return The last keyframe starting at or before the tick (the first one before it starts)
+ */
+int get_wind_keyframe(const WindField * field, int tick) {
+	int keyframe = field->n_keyframes - 1;
+	while (keyframe > 0 && field->ticks[keyframe] > tick) {
+		keyframe--;
+	}
+
+	return keyframe;
+}
+
+/**
+ * Sample the wind of a keyframe at a point of the map, interpolating bilinearly the wind vectors of the 4 nearest
+ * cells of the raster (so a wind turning from 350 to 10 degrees goes through 0)
+ *
+ * @param field The wind field
+ * @param keyframe The keyframe
+ * @param u The position along x, from 0 to 1
+ * @param v The position along y, from 0 to 1
+ * @param direction The sampled direction (0 to 360)
+ * @param speed The sampled speed
+ */
+void sample_wind(const WindField * field, int keyframe, double u, double v, double * direction, double * speed) {
+	// The values of the raster are at the centers of its cells
+	double x = fmin(fmax(u * field->width - .5, 0), field->width - 1);
+	double y = fmin(fmax(v * field->height - .5, 0), field->height - 1);
+	int x0 = (int) x;
+	int y0 = (int) y;
+	int x1 = min(x0 + 1, field->width - 1);
+	int y1 = min(y0 + 1, field->height - 1);
+	double fx = x - x0;
+	double fy = y - y0;
+
+	const double * directions = field->directions + (size_t) keyframe * field->width * field->height;
+	const double * speeds = field->speeds + (size_t) keyframe * field->width * field->height;
+	int corners[4] = {x0 * field->height + y0, x1 * field->height + y0, x0 * field->height + y1,
+					  x1 * field->height + y1};
+	double weights[4] = {(1 - fx) * (1 - fy), fx * (1 - fy), (1 - fx) * fy, fx * fy};
+
+	// Same axes as get_wind
+	double wind_x = 0;
+	double wind_y = 0;
+	for (int c = 0; c < 4; c++) {
+		wind_x += weights[c] * speeds[corners[c]] * sin(directions[corners[c]] * M_PI / 180.);
+		wind_y += weights[c] * speeds[corners[c]] * cos(directions[corners[c]] * M_PI / 180.);
+	}
+
+	*speed = sqrt(wind_x * wind_x + wind_y * wind_y);
+	*direction = fmod(atan2(wind_x, wind_y) * 180. / M_PI + 360., 360.);
+}
+
+/**
+ * Get the spread probabilities around a tile on fire
+ * <p>
+ * Without wind field, they are the ones of the grid. Otherwise each cell of WIND_CELL_SIZE x WIND_CELL_SIZE tiles has
+ * its own table, sampled at its center. A table is computed again only when it is used after its keyframe ended, so
+ * only the cells reached by the fire are computed.
+ * </p>
+ *
+ * @param grid The grid, its current tick selects the keyframe
+ * @param point The tile on fire
+ * @return The spread probabilities
+ */
+const SpreadTable * get_spread_at(Grid * grid, Point point) {
+	if (wind_field == NULL) {
+		return &grid->spread;
+	}
+
+	int n_cells = (grid->size + WIND_CELL_SIZE - 1) / WIND_CELL_SIZE;
+	if (grid->wind_tables == NULL) {
+		grid->wind_tables = malloc((size_t) n_cells * n_cells * sizeof(*grid->wind_tables));
+		grid->wind_keyframes = malloc((size_t) n_cells * n_cells * sizeof(*grid->wind_keyframes));
+		for (int c = 0; c < n_cells * n_cells; c++) {
+			grid->wind_keyframes[c] = -1;
+		}
+	}
+
+	int cx = point.x / WIND_CELL_SIZE;
+	int cy = point.y / WIND_CELL_SIZE;
+	int cell = cx * n_cells + cy;
+	int keyframe = get_wind_keyframe(wind_field, grid->n_ticks);
+
+	if (grid->wind_keyframes[cell] != keyframe) {
+		double direction;
+		double speed;
+		double u = fmin((cx + .5) * WIND_CELL_SIZE, grid->size) / grid->size;
+		double v = fmin((cy + .5) * WIND_CELL_SIZE, grid->size) / grid->size;
+
+		sample_wind(wind_field, keyframe, u, v, &direction, &speed);
+		grid->wind_tables[cell] = create_spread_table(direction, speed);
+		grid->wind_keyframes[cell] = keyframe;
+	}
+
+	return &grid->wind_tables[cell];
+}
+
+/**
+ * Free the spread tables of the wind field of a grid, they are computed again on their next use
+ *
+ * @param grid The grid
+ */
+void free_wind_tables(Grid * grid) {
+	free(grid->wind_tables);
+	free(grid->wind_keyframes);
+	grid->wind_tables = NULL;
+	grid->wind_keyframes = NULL;
+}